@@ -4,44 +4,113 @@
 #include "julian_date.h"
 #include <cmath>
 
-struct Angle {
-    [[nodiscard]] constexpr double deg() const { return value * (180.0 / M_PI); }
-    [[nodiscard]] constexpr double rad() const { return value; }
+// An angle stored in radians as a T. Everything in the tree uses Angle, the double variant; AngleF is for the single
+// precision variant of get_sun_times_soa.
+template<class T>
+struct basic_angle {
+    using value_type = T;
 
-    static constexpr Angle from_rad(double rad) { return Angle(rad); }
-    static constexpr Angle from_deg(double deg) { return Angle(deg * (M_PI / 180.0)); }
+    [[nodiscard]] constexpr T deg() const { return value * T(180.0 / M_PI); }
+    [[nodiscard]] constexpr T rad() const { return value; }
 
-    explicit constexpr Angle(julian_date::julian_days j_days) : value(j_days.count() * (2 * M_PI)) {}
+    static constexpr basic_angle from_rad(T rad) { return basic_angle(rad); }
+    static constexpr basic_angle from_deg(T deg) { return basic_angle(deg * T(M_PI / 180.0)); }
+
+    explicit constexpr basic_angle(julian_date::julian_days j_days) : value(T(j_days.count() * (2 * M_PI))) {}
+
+    // Converts between precisions, rounding to the nearest T
+    template<class U>
+    explicit constexpr basic_angle(basic_angle<U> other) : value(T(other.rad())) {}
 
     explicit operator julian_date::julian_days() const { return julian_date::julian_days{value / (2 * M_PI)}; }
 
 private:
-    explicit constexpr Angle(double rad) : value(rad) {}
+    explicit constexpr basic_angle(T rad) : value(rad) {}
 
-    double value;
+    T value;
 };
 
-inline auto sin(Angle a) -> double { return ::sin(a.rad()); }
-inline auto cos(Angle a) -> double { return ::cos(a.rad()); }
-inline auto tan(Angle a) -> double { return ::tan(a.rad()); }
-
-inline auto operator*(double lhs, Angle rhs) -> Angle { return Angle::from_rad(lhs * rhs.rad()); }
-
-inline auto operator*(Angle lhs, double rhs) -> Angle { return Angle::from_rad(lhs.rad() * rhs); }
-
-inline auto operator/(Angle lhs, double rhs) -> Angle { return Angle::from_rad(lhs.rad() / rhs); }
-
-inline auto operator+(Angle lhs, Angle rhs) -> Angle { return Angle::from_rad(lhs.rad() + rhs.rad()); }
-
-inline auto operator-(Angle lhs, Angle rhs) -> Angle { return Angle::from_rad(lhs.rad() - rhs.rad()); }
-
-inline auto operator==(Angle lhs, Angle rhs) -> bool { return lhs.rad() == rhs.rad(); }
-
-inline auto operator!=(Angle lhs, Angle rhs) -> bool { return !(lhs == rhs); }
+using Angle = basic_angle<double>;
+using AngleF = basic_angle<float>;
+
+template<class T>
+inline auto sin(basic_angle<T> a) -> T {
+    return std::sin(a.rad());
+}
+template<class T>
+inline auto cos(basic_angle<T> a) -> T {
+    return std::cos(a.rad());
+}
+template<class T>
+inline auto tan(basic_angle<T> a) -> T {
+    return std::tan(a.rad());
+}
+
+// The scalars are typename basic_angle<T>::value_type, so T is only deduced from the angle and 2 * a works as well.
+template<class T>
+inline auto operator*(typename basic_angle<T>::value_type lhs, basic_angle<T> rhs) -> basic_angle<T> {
+    return basic_angle<T>::from_rad(lhs * rhs.rad());
+}
+
+template<class T>
+inline auto operator*(basic_angle<T> lhs, typename basic_angle<T>::value_type rhs) -> basic_angle<T> {
+    return basic_angle<T>::from_rad(lhs.rad() * rhs);
+}
+
+template<class T>
+inline auto operator/(basic_angle<T> lhs, typename basic_angle<T>::value_type rhs) -> basic_angle<T> {
+    return basic_angle<T>::from_rad(lhs.rad() / rhs);
+}
+
+template<class T>
+inline auto operator+(basic_angle<T> lhs, basic_angle<T> rhs) -> basic_angle<T> {
+    return basic_angle<T>::from_rad(lhs.rad() + rhs.rad());
+}
+
+template<class T>
+inline auto operator-(basic_angle<T> lhs, basic_angle<T> rhs) -> basic_angle<T> {
+    return basic_angle<T>::from_rad(lhs.rad() - rhs.rad());
+}
+
+template<class T>
+inline auto operator==(basic_angle<T> lhs, basic_angle<T> rhs) -> bool {
+    return lhs.rad() == rhs.rad();
+}
+
+template<class T>
+inline auto operator!=(basic_angle<T> lhs, basic_angle<T> rhs) -> bool {
+    return !(lhs == rhs);
+}
+
+// The Taylor series of sin(y) for |y| <= pi/2, nested from the smallest term
+constexpr long double constexpr_sin_series(long double y) {
+    long double r = 1.0;
+    for (int n = 30; n > 0; n--) { r = 1.0 - y * y / ((2 * n) * (2 * n + 1)) * r; }
+    return y * r;
+}
+
+// cos() and sin() for constant expressions, like the cosines of the SunTime angles. They match cos() and sin() for
+// those, and are at most an ulp off anywhere in [-pi, pi].
+constexpr double constexpr_cos(double x) {
+    // cos(x) = sin(pi/2 - x), with pi/2 in two parts to keep the precision of results close to zero
+    constexpr double pi_2_hi = 1.5707963267948966, pi_2_lo = 6.123233995736766e-17;
+    long double y = (pi_2_hi - (x < 0 ? -x : x)) + static_cast<long double>(pi_2_lo);
+    return static_cast<double>(constexpr_sin_series(y));
+}
+
+constexpr double constexpr_sin(double x) {
+    // sin(x) = sin(pi - x) beyond pi/2, with pi in two parts as above
+    constexpr double pi_hi = 3.141592653589793, pi_lo = 1.2246467991473532e-16;
+    const auto a = x < 0 ? -x : x;
+    long double y = a <= pi_hi / 2 ? a : (pi_hi - a) + static_cast<long double>(pi_lo);
+    const auto r = static_cast<double>(constexpr_sin_series(y));
+    return x < 0 ? -r : r;
+}
 
 static_assert(Angle::from_rad(0).deg() == 0);
 static_assert(Angle::from_deg(90).rad() == M_PI / 2);
 static_assert(Angle::from_rad(M_PI).deg() == 180);
 static_assert(Angle::from_deg(360).rad() == 2 * M_PI);
+static_assert(AngleF::from_deg(90).rad() == float(M_PI / 2));
 
 #endif//SOLAR_CALCULATIONS_ANGLE_H
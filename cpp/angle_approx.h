@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
+
+// Polynomial sin, cos, tan, asin and acos for Angle, for when libm is the bottleneck and a known error is fine. The
+// polynomials are minimax fits (Remez exchange) of sin and cos on [-pi/4, pi/4], which every argument is reduced to
+// first, and of acos(x) / sqrt(1 - x) on [0, 1]. The largest absolute errors over all arguments are, per precision:
+//
+//   precision   sin, cos   tan(x), |x| <= 1.4   asin, acos
+//   low         1e-5       3e-5                 7e-5
+//   medium      3e-8       9e-8                 2e-8
+//   high        4e-12      2e-11                2e-12
+//
+// These hold for angles up to 6e6 radians. sin, cos and tan of larger angles, infinities and NaN are calculated by libm
+// instead, so they are as exact as std::sin and friends and NaN where those are.
+//
+// Every call site can pick its own precision as a template argument; the ones without use default_trig_precision.
+
+#ifndef SOLAR_CALCULATIONS_ANGLE_APPROX_H
+#define SOLAR_CALCULATIONS_ANGLE_APPROX_H
+
+#include "angle.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+enum class trig_precision {
+    low,
+    medium,
+    high,
+};
+
+// The precision of the approx functions if none is given: medium, unless SUN_TRIG_PRECISION is defined to one of the
+// names of trig_precision, like the CMake cache variable of the same name does for the sun library.
+#ifdef SUN_TRIG_PRECISION
+constexpr trig_precision default_trig_precision = trig_precision::SUN_TRIG_PRECISION;
+#else
+constexpr trig_precision default_trig_precision = trig_precision::medium;
+#endif
+
+namespace approx {
+    namespace detail {
+        // The coefficients of x^0, x^2, x^4 and so on of sin(x) / x and cos(x), and of x^0, x^1, x^2 and so on of
+        // acos(x) / sqrt(1 - x)
+        template<trig_precision P>
+        struct polynomials;
+
+        template<>
+        struct polynomials<trig_precision::low> {
+            static constexpr double sin[] = {0.9999985694134645, -0.16662480167809043, 0.008151635577953337};
+            static constexpr double cos[] = {0.9999900349552177, -0.4997081403547538, 0.040398535966200445};
+            static constexpr double acos[] = {1.5707288189746758, -0.21211524052726569, 0.07426234457866795,
+                                              -0.0187298684732037};
+        };
+
+        template<>
+        struct polynomials<trig_precision::medium> {
+            static constexpr double sin[] = {0.999999996926343, -0.16666650699202948, 0.008332036875168156,
+                                             -0.00019504022000659164};
+            static constexpr double cos[] = {0.9999999724233256, -0.49999856695853917, 0.04165502688433452,
+                                             -0.001358590851012519};
+            static constexpr double acos[] = {1.5707963049952853,    -0.2145988038330987,   0.0889790498748978,
+                                              -0.05017471509016449,  0.03089305283200221,   -0.017089810257720373,
+                                              0.006671292851019542, -0.0012628307987374021};
+        };
+
+        template<>
+        struct polynomials<trig_precision::high> {
+            static constexpr double sin[] = {0.9999999999956816, -0.16666666631635493, 0.008333328786055506,
+                                             -0.0001983920314567179, 2.7173532532533448e-06};
+            static constexpr double cos[] = {0.9999999999999445,     -0.4999999999935185,   0.04166666654400953,
+                                             -0.0013888880398372782, 2.479892963082329e-05, -2.7173487989781355e-07};
+            static constexpr double acos[] = {
+                    1.5707963267933005,     -0.21460183603238212,  0.08904858875781357,   -0.050792024600491335,
+                    0.03367162276088546,    -0.024303153653591654, 0.01832979599930828,   -0.013751037615778759,
+                    0.00952721340440434,    -0.005532020673443125, 0.0024008874218198334, -0.0006685740304696693,
+                    8.777384331574771e-05};
+        };
+
+        template<std::size_t N>
+        constexpr double horner(const double (&c)[N], double x) {
+            double r = c[N - 1];
+            for (std::size_t i = N - 1; i-- > 0;) { r = r * x + c[i]; }
+            return r;
+        }
+
+        // The largest |x| reduce takes: its multiple of pi/2 stays below 2^22, where the product with the 31 bits of
+        // pi_2_hi is still exact. The mean anomaly only gets to a few hundred radians.
+        constexpr double max_reduce = 6.0e6;
+
+        // Returns x reduced to [-pi/4, pi/4] by a multiple of pi/2, and that multiple modulo 4 in quadrant. pi/2 is
+        // taken in two parts, the first with its lower bits zero, which keeps the reduction exact for |x| up to
+        // max_reduce. Only finite x that small may be passed, the cast is undefined for anything else.
+        inline double reduce(double x, unsigned &quadrant) {
+            constexpr double pi_2_hi = 1.57079632673412561417, pi_2_lo = 6.07710050650619224932e-11;
+            const auto n = static_cast<std::int64_t>(x * (2 / M_PI) + (x < 0 ? -0.5 : 0.5));
+            quadrant = static_cast<unsigned>(n) & 3u;
+            const auto q = static_cast<double>(n);
+            return (x - q * pi_2_hi) - q * pi_2_lo;
+        }
+
+        template<trig_precision P>
+        void sincos(double x, double &s, double &c) {
+            // NaN, infinities and arguments too large to reduce go to libm, which returns NaN for the first two
+            if (!(x >= -max_reduce && x <= max_reduce)) {
+                s = std::sin(x), c = std::cos(x);
+                return;
+            }
+            unsigned quadrant;
+            const auto r = reduce(x, quadrant);
+            const auto z = r * r;
+            const auto sin_r = r * horner(polynomials<P>::sin, z);
+            const auto cos_r = horner(polynomials<P>::cos, z);
+            switch (quadrant) {
+                case 0: s = sin_r, c = cos_r; break;
+                case 1: s = cos_r, c = -sin_r; break;
+                case 2: s = -sin_r, c = -cos_r; break;
+                default: s = -cos_r, c = sin_r; break;
+            }
+        }
+    }// namespace detail
+
+    template<trig_precision P = default_trig_precision>
+    inline double sin(Angle a) {
+        double s, c;
+        detail::sincos<P>(a.rad(), s, c);
+        return s;
+    }
+
+    template<trig_precision P = default_trig_precision>
+    inline double cos(Angle a) {
+        double s, c;
+        detail::sincos<P>(a.rad(), s, c);
+        return c;
+    }
+
+    template<trig_precision P = default_trig_precision>
+    inline double tan(Angle a) {
+        double s, c;
+        detail::sincos<P>(a.rad(), s, c);
+        return s / c;
+    }
+
+    // Like std::acos, NaN for |x| > 1
+    template<trig_precision P = default_trig_precision>
+    inline double acos(double x) {
+        if (!(x >= -1.0 && x <= 1.0)) return std::numeric_limits<double>::quiet_NaN();
+        const auto a = x < 0 ? -x : x;
+        const auto r = std::sqrt(1.0 - a) * detail::horner(detail::polynomials<P>::acos, a);
+        return x < 0 ? M_PI - r : r;
+    }
+
+    template<trig_precision P = default_trig_precision>
+    inline double asin(double x) {
+        return M_PI / 2 - acos<P>(x);
+    }
+}// namespace approx
+
+#endif//SOLAR_CALCULATIONS_ANGLE_APPROX_H
@@ -1,15 +1,20 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 // SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
 
+#include "rust_sun_ffi.h"
 #include "sun.h"
+#include <algorithm>
 #include <benchmark/benchmark.h>
+#include <cmath>
+#include <optional>
+#include <vector>
 
 using date::days;
 using std::chrono::floor;
 using std::chrono::system_clock;
 
-static const auto lat = Angle::from_deg(52.02182);
-static const auto lon = Angle::from_deg(8.53509);
+static constexpr auto lat = Angle::from_deg(52.02182);
+static constexpr auto lon = Angle::from_deg(8.53509);
 
 static void BM_sun_times_wiki(benchmark::State &state) {
     // Perform setup here
@@ -33,6 +38,51 @@ static void BM_sun_times_c(benchmark::State &state) {
 // Register the function as a benchmark
 BENCHMARK(BM_sun_times_c);
 
+static void BM_sun_times_core(benchmark::State &state) {
+    // Perform setup here
+    auto tp = floor<days>(system_clock::now());
+    for (auto _: state) {
+        // This code gets timed
+        sun::get_sun_times_core(lat, lon, tp);
+    }
+}
+// Register the function as a benchmark
+BENCHMARK(BM_sun_times_core);
+
+static void BM_sun_times_c_batch(benchmark::State &state) {
+    // Perform setup here
+    auto tp = floor<days>(system_clock::now());
+    std::vector<sun::location> locations;
+    for (int64_t i = 0; i < state.range(0); i++) {
+        locations.push_back({lat + Angle::from_deg(0.001 * i), lon + Angle::from_deg(0.001 * i)});
+    }
+    std::vector<sun::sun_times> out(locations.size());
+    for (auto _: state) {
+        // This code gets timed
+        sun::get_sun_times_c(locations.data(), locations.size(), tp, out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+// Register the function as a benchmark
+BENCHMARK(BM_sun_times_c_batch)->Arg(1)->Arg(64)->Arg(4096);
+
+static void BM_sun_times_core_batch(benchmark::State &state) {
+    // Perform setup here
+    auto tp = floor<days>(system_clock::now());
+    std::vector<sun::location> locations;
+    for (int64_t i = 0; i < state.range(0); i++) {
+        locations.push_back({lat + Angle::from_deg(0.001 * i), lon + Angle::from_deg(0.001 * i)});
+    }
+    std::vector<sun::sun_times> out(locations.size());
+    for (auto _: state) {
+        // This code gets timed
+        sun::get_sun_times_core(locations.data(), locations.size(), tp, out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+// Register the function as a benchmark
+BENCHMARK(BM_sun_times_core_batch)->Arg(1)->Arg(64)->Arg(4096);
+
 static void BM_sun_times_noaa(benchmark::State &state) {
     // Perform setup here
     auto tp = floor<days>(system_clock::now());
@@ -55,6 +105,400 @@ static void BM_sun_times_noaa_opt(benchmark::State &state) {
 // Register the function as a benchmark
 BENCHMARK(BM_sun_times_noaa_opt);
 
+// With the polynomial trigonometry of angle_approx.h instead of libm
+template<trig_precision P>
+static void BM_sun_times_noaa_approx(benchmark::State &state) {
+    // Perform setup here
+    auto tp = floor<days>(system_clock::now());
+    for (auto _: state) {
+        // This code gets timed
+        sun::noaa::get_sun_times_approx<P>(lat, lon, tp);
+    }
+}
+// Register the function as a benchmark
+BENCHMARK_TEMPLATE(BM_sun_times_noaa_approx, trig_precision::low);
+BENCHMARK_TEMPLATE(BM_sun_times_noaa_approx, trig_precision::medium);
+BENCHMARK_TEMPLATE(BM_sun_times_noaa_approx, trig_precision::high);
+
+// The same calls with the noon memo installed, as a server asking for the same location again would
+static void BM_sun_times_noaa_memo(benchmark::State &state) {
+    // Perform setup here
+    auto tp = floor<days>(system_clock::now());
+    auto memo = sun::noaa::noon_memo();
+    sun::noaa::use_noon_memo(&memo);
+    for (auto _: state) {
+        // This code gets timed
+        sun::noaa::get_sun_times(lat, lon, tp);
+    }
+    sun::noaa::use_noon_memo(nullptr);
+}
+// Register the function as a benchmark
+BENCHMARK(BM_sun_times_noaa_memo);
+
+static void BM_sun_times_noaa_opt_memo(benchmark::State &state) {
+    // Perform setup here
+    auto tp = floor<days>(system_clock::now());
+    auto memo = sun::noaa::noon_memo();
+    sun::noaa::use_noon_memo(&memo);
+    for (auto _: state) {
+        // This code gets timed
+        sun::noaa::get_sun_times_opt(lat, lon, tp);
+    }
+    sun::noaa::use_noon_memo(nullptr);
+}
+// Register the function as a benchmark
+BENCHMARK(BM_sun_times_noaa_opt_memo);
+
+static void BM_sun_times_noaa_batch(benchmark::State &state) {
+    // Perform setup here
+    auto tp = floor<days>(system_clock::now());
+    std::vector<sun::location> locations;
+    for (int64_t i = 0; i < state.range(0); i++) {
+        locations.push_back({lat + Angle::from_deg(0.001 * i), lon + Angle::from_deg(0.001 * i)});
+    }
+    std::vector<sun::sun_times> out(locations.size());
+    for (auto _: state) {
+        // This code gets timed
+        sun::noaa::get_sun_times_batch(locations.data(), locations.size(), tp, out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+// Register the function as a benchmark
+BENCHMARK(BM_sun_times_noaa_batch)->Arg(1)->Arg(64)->Arg(4096);
+
+// Same as above, but for the local day in a zone, with the offsets of the zone read once before
+static void BM_sun_times_noaa_local_batch(benchmark::State &state) {
+    // Perform setup here
+    auto tp = floor<days>(system_clock::now());
+    const auto zone = sun::zone_offsets(date::locate_zone("Europe/Berlin"), tp, tp + days(365));
+    const auto day = date::local_days(tp.time_since_epoch());
+    std::vector<sun::location> locations;
+    for (int64_t i = 0; i < state.range(0); i++) {
+        locations.push_back({lat + Angle::from_deg(0.001 * i), lon + Angle::from_deg(0.001 * i)});
+    }
+    std::vector<sun::local_sun_times> out(locations.size());
+    for (auto _: state) {
+        // This code gets timed
+        sun::noaa::get_local_sun_times_batch(locations.data(), locations.size(), day, zone, out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+// Register the function as a benchmark
+BENCHMARK(BM_sun_times_noaa_local_batch)->Arg(1)->Arg(64)->Arg(4096);
+
+static void BM_sun_times_noaa_opt_sunrise_sunset(benchmark::State &state) {
+    // Perform setup here
+    auto tp = floor<days>(system_clock::now());
+    for (auto _: state) {
+        // This code gets timed
+        sun::noaa::get_sun_times_opt<sun::sun_event::sunrise, sun::sun_event::sunset>(lat, lon, tp);
+    }
+}
+// Register the function as a benchmark
+BENCHMARK(BM_sun_times_noaa_opt_sunrise_sunset);
+
+static void BM_sun_times_noaa_opt_mask(benchmark::State &state) {
+    // Perform setup here
+    auto tp = floor<days>(system_clock::now());
+    auto events = sun::sun_event::sunrise | sun::sun_event::sunset;
+    for (auto _: state) {
+        // This code gets timed
+        sun::noaa::get_sun_times_opt(lat, lon, tp, events);
+    }
+}
+// Register the function as a benchmark
+BENCHMARK(BM_sun_times_noaa_opt_mask);
+
+// The largest difference between any event time with the ephemeris and without, over a year on a global grid
+static double ephemeris_error_bound(const sun::noaa::daily_ephemeris &ephemeris, date::sys_days first_day) {
+    auto max_error = 0.0;
+    auto error = [&](auto lhs, auto rhs) {
+        if (lhs && rhs) max_error = std::max(max_error, std::abs(static_cast<double>((*lhs - *rhs).count())));
+        else if (lhs || rhs)
+            max_error = INFINITY;
+    };
+    for (auto d = first_day; d < first_day + days(365); d += days(7)) {
+        for (auto la = -85.0; la <= 85.0; la += 5.0) {
+            for (auto lo = -180.0; lo < 180.0; lo += 30.0) {
+                auto a = sun::noaa::get_sun_times_opt(Angle::from_deg(la), Angle::from_deg(lo), d, ephemeris);
+                auto b = sun::noaa::get_sun_times_opt(Angle::from_deg(la), Angle::from_deg(lo), d);
+                error(std::optional(a.noon), std::optional(b.noon));
+                error(a.astro_dawn, b.astro_dawn);
+                error(a.naut_dawn, b.naut_dawn);
+                error(a.civil_dawn, b.civil_dawn);
+                error(a.sunrise, b.sunrise);
+                error(a.sunset, b.sunset);
+                error(a.civil_dusk, b.civil_dusk);
+                error(a.naut_dusk, b.naut_dusk);
+                error(a.astro_dusk, b.astro_dusk);
+            }
+        }
+    }
+    return max_error;
+}
+
+static void BM_sun_times_noaa_ephemeris(benchmark::State &state) {
+    // Perform setup here
+    auto tp = floor<days>(system_clock::now());
+    auto ephemeris = sun::noaa::daily_ephemeris(tp, tp + days(365), static_cast<unsigned>(state.range(0)));
+    for (auto _: state) {
+        // This code gets timed
+        sun::noaa::get_sun_times_opt(lat, lon, tp, ephemeris);
+    }
+    state.counters["max_error_s"] = ephemeris_error_bound(ephemeris, tp);
+    state.counters["bytes_per_year"] = static_cast<double>(ephemeris.size_bytes());
+}
+// Register the function as a benchmark
+BENCHMARK(BM_sun_times_noaa_ephemeris)->ArgName("samples_per_day")->Arg(1)->Arg(4)->Arg(24);
+
+static void BM_sun_times_noaa_batch_ephemeris(benchmark::State &state) {
+    // Perform setup here
+    auto tp = floor<days>(system_clock::now());
+    auto ephemeris = sun::noaa::daily_ephemeris(tp, tp);
+    std::vector<sun::location> locations;
+    for (int64_t i = 0; i < state.range(0); i++) {
+        locations.push_back({lat + Angle::from_deg(0.001 * i), lon + Angle::from_deg(0.001 * i)});
+    }
+    std::vector<sun::sun_times> out(locations.size());
+    for (auto _: state) {
+        // This code gets timed
+        sun::noaa::get_sun_times_batch(locations.data(), locations.size(), tp, out.data(), ephemeris);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+// Register the function as a benchmark
+BENCHMARK(BM_sun_times_noaa_batch_ephemeris)->Arg(4096);
+
+static void BM_sun_times_noaa_range(benchmark::State &state) {
+    // Perform setup here
+    auto tp = floor<days>(system_clock::now());
+    std::vector<sun::sun_times> out(365);
+    for (auto _: state) {
+        // This code gets timed
+        sun::noaa::get_sun_times_range(lat, lon, tp, out.size(), out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * out.size());
+}
+// Register the function as a benchmark
+BENCHMARK(BM_sun_times_noaa_range);
+
+// A year of events from the stream, one item per event
+static void BM_sun_times_noaa_stream(benchmark::State &state) {
+    // Perform setup here
+    auto from = date::sys_seconds(floor<days>(system_clock::now()));
+    auto until = from + days(365);
+    int64_t events = 0;
+    for (auto _: state) {
+        // This code gets timed
+        for (const auto &e: sun::noaa::event_stream(lat, lon, from)) {
+            if (e.time >= until) break;
+            events++;
+        }
+    }
+    state.SetItemsProcessed(events);
+}
+// Register the function as a benchmark
+BENCHMARK(BM_sun_times_noaa_stream);
+
+// T is the precision, double for Angle and float for AngleF, which fits twice the lanes into a register
+template<class T>
+static void BM_sun_times_noaa_soa(benchmark::State &state) {
+    // Perform setup here
+    auto lanes = static_cast<unsigned>(state.range(0));
+    if (lanes > sun::noaa::simd_lanes() * (sizeof(double) / sizeof(T))) {
+        state.SkipWithError("lane count not supported by this CPU");
+        return;
+    }
+    auto tp = floor<days>(system_clock::now());
+    constexpr std::size_t count = 4096;
+    std::vector<basic_angle<T>> latitudes, longitudes;
+    for (std::size_t i = 0; i < count; i++) {
+        latitudes.emplace_back(lat + Angle::from_deg(0.001 * i));
+        longitudes.emplace_back(lon + Angle::from_deg(0.001 * i));
+    }
+    std::vector<double> buf(10 * count);
+    auto column = [&](std::size_t n) { return buf.data() + n * count; };
+    const auto out = sun::noaa::sun_times_soa{column(0), column(1), column(2), column(3), column(4),
+                                              column(5), column(6), column(7), column(8), column(9)};
+    for (auto _: state) {
+        // This code gets timed
+        sun::noaa::get_sun_times_soa(latitudes.data(), longitudes.data(), count, tp, out, lanes);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+// Register the function as a benchmark
+BENCHMARK_TEMPLATE(BM_sun_times_noaa_soa, double)->ArgName("lanes")->Arg(1)->Arg(2)->Arg(4)->Arg(8);
+BENCHMARK_TEMPLATE(BM_sun_times_noaa_soa, float)->ArgName("lanes")->Arg(1)->Arg(4)->Arg(8)->Arg(16);
+
+static void BM_sun_times_noaa_soa_table(benchmark::State &state) {
+    // Perform setup here
+    auto tp = floor<days>(system_clock::now());
+    constexpr std::size_t count = 4096;
+    std::vector<Angle> latitudes, longitudes;
+    for (std::size_t i = 0; i < count; i++) {
+        latitudes.push_back(lat + Angle::from_deg(0.001 * i));
+        longitudes.push_back(lon + Angle::from_deg(0.001 * i));
+    }
+    auto table = sun::sun_times_table(count, tp, 1);
+    for (auto _: state) {
+        // This code gets timed
+        sun::noaa::get_sun_times_soa(latitudes.data(), longitudes.data(), table, 0);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+// Register the function as a benchmark
+BENCHMARK(BM_sun_times_noaa_soa_table);
+
+static void BM_sun_times_noaa_grid(benchmark::State &state) {
+    // Perform setup here
+    auto tp = floor<days>(system_clock::now());
+    auto threads = static_cast<unsigned>(state.range(0));
+    // Pole to pole, so the polar rows are part of the grid
+    constexpr std::size_t count = 16384;
+    std::vector<Angle> latitudes, longitudes;
+    for (std::size_t i = 0; i < count; i++) {
+        latitudes.push_back(Angle::from_deg(-89.0 + 178.0 * i / count));
+        longitudes.push_back(Angle::from_deg(-180.0 + 0.7 * i));
+    }
+    auto table = sun::sun_times_table(count, tp, 30);
+    for (auto _: state) {
+        // This code gets timed
+        sun::noaa::get_sun_times_grid(latitudes.data(), longitudes.data(), table, threads);
+    }
+    state.SetItemsProcessed(state.iterations() * count * table.days());
+}
+// Register the function as a benchmark
+BENCHMARK(BM_sun_times_noaa_grid)->ArgName("threads")->RangeMultiplier(2)->Range(1, 64)->UseRealTime();
+
+// 4096 devices within about a kilometer of each other, looked up through a cache with cells of about 100 meters
+static void BM_sun_times_noaa_cache(benchmark::State &state) {
+    // Perform setup here
+    auto tp = floor<days>(system_clock::now());
+    constexpr std::size_t count = 4096;
+    std::vector<Angle> latitudes, longitudes;
+    for (std::size_t i = 0; i < count; i++) {
+        latitudes.push_back(lat + Angle::from_deg(0.01 * std::sin(0.1 * i)));
+        longitudes.push_back(lon + Angle::from_deg(0.01 * std::cos(0.37 * i)));
+    }
+    auto cache = sun::noaa::sun_times_cache(Angle::from_deg(0.001));
+    for (auto _: state) {
+        // This code gets timed
+        for (std::size_t i = 0; i < count; i++) {
+            benchmark::DoNotOptimize(cache.get(latitudes[i], longitudes[i], tp));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+    state.counters["hit_rate"] = static_cast<double>(cache.hits()) / static_cast<double>(cache.hits() + cache.misses());
+    state.counters["max_error_s"] =
+            cache.error_bound(Angle::from_deg(60), sun::sun_event::sunrise | sun::sun_event::sunset);
+}
+// Register the function as a benchmark
+BENCHMARK(BM_sun_times_noaa_cache);
+
+// The next sunrise from a day in the middle of the polar night at Vostok, and from the same day at the default location
+static void BM_next_crossing_noaa(benchmark::State &state) {
+    // Perform setup here
+    auto from = date::sys_seconds(date::sys_days(date::June / 21 / 2023));
+    auto latitude = state.range(0) ? Angle::from_deg(-78.463889) : lat;
+    auto longitude = state.range(0) ? Angle::from_deg(106.83757) : lon;
+    for (auto _: state) {
+        // This code gets timed
+        benchmark::DoNotOptimize(sun::noaa::next_crossing(latitude, longitude, from, sun::SunTime::Sunrise));
+    }
+}
+// Register the function as a benchmark
+BENCHMARK(BM_next_crossing_noaa)->ArgName("polar")->Arg(0)->Arg(1);
+
+// One elevation per minute over a day, as for a dimmer curve
+static void BM_sun_elevation_noaa(benchmark::State &state) {
+    // Perform setup here
+    auto tp = date::sys_seconds(floor<days>(system_clock::now()));
+    std::vector<Angle> out(1440, Angle::from_rad(0));
+    for (auto _: state) {
+        // This code gets timed
+        for (std::size_t i = 0; i < out.size(); i++) {
+            out[i] = sun::noaa::get_sun_elevation(lat, lon, tp + std::chrono::minutes(i));
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * out.size());
+}
+// Register the function as a benchmark
+BENCHMARK(BM_sun_elevation_noaa);
+
+static void BM_sun_elevation_sampler(benchmark::State &state) {
+    // Perform setup here
+    auto day = floor<days>(system_clock::now());
+    std::vector<Angle> out(1440, Angle::from_rad(0));
+    for (auto _: state) {
+        // This code gets timed
+        auto sampler = sun::noaa::elevation_sampler(lat, lon, day);
+        sampler.fill(date::sys_seconds(day), std::chrono::minutes(1), out.size(), out.data());
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * out.size());
+}
+// Register the function as a benchmark
+BENCHMARK(BM_sun_elevation_sampler);
+
+// Elevation and azimuth once per minute over a day, one get_sun_position at a time as a baseline for the batches
+static void BM_sun_position_noaa(benchmark::State &state) {
+    // Perform setup here
+    auto tp = date::sys_seconds(floor<days>(system_clock::now()));
+    std::vector<sun::noaa::sun_position> out(1440, {Angle::from_rad(0), Angle::from_rad(0)});
+    for (auto _: state) {
+        // This code gets timed
+        for (std::size_t i = 0; i < out.size(); i++) {
+            out[i] = sun::noaa::get_sun_position(lat, lon, tp + std::chrono::minutes(i));
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * out.size());
+}
+// Register the function as a benchmark
+BENCHMARK(BM_sun_position_noaa);
+
+// Same time points as above, given as an array like a tracker schedule
+static void BM_sun_positions_series(benchmark::State &state) {
+    // Perform setup here
+    auto tp = date::sys_seconds(floor<days>(system_clock::now()));
+    std::vector<date::sys_seconds> time_points;
+    for (int i = 0; i < 1440; i++) { time_points.push_back(tp + std::chrono::minutes(i)); }
+    std::vector<Angle> elevation(time_points.size(), Angle::from_rad(0)), azimuth = elevation;
+    for (auto _: state) {
+        // This code gets timed
+        sun::noaa::get_sun_positions(lat, lon, time_points.data(), time_points.size(),
+                                     {elevation.data(), azimuth.data()});
+        benchmark::DoNotOptimize(elevation.data());
+        benchmark::DoNotOptimize(azimuth.data());
+    }
+    state.SetItemsProcessed(state.iterations() * time_points.size());
+}
+// Register the function as a benchmark
+BENCHMARK(BM_sun_positions_series);
+
+// The positions of many locations at one time point, as for a shading map
+static void BM_sun_positions_locations(benchmark::State &state) {
+    // Perform setup here
+    auto tp = date::sys_seconds(floor<days>(system_clock::now())) + std::chrono::hours(10);
+    std::vector<Angle> latitudes, longitudes;
+    for (int64_t i = 0; i < state.range(0); i++) {
+        latitudes.push_back(lat + Angle::from_deg(0.001 * i));
+        longitudes.push_back(lon + Angle::from_deg(0.001 * i));
+    }
+    std::vector<Angle> elevation(latitudes.size(), Angle::from_rad(0)), azimuth = elevation;
+    for (auto _: state) {
+        // This code gets timed
+        sun::noaa::get_sun_positions(latitudes.data(), longitudes.data(), latitudes.size(), tp,
+                                     {elevation.data(), azimuth.data()});
+        benchmark::DoNotOptimize(elevation.data());
+        benchmark::DoNotOptimize(azimuth.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+// Register the function as a benchmark
+BENCHMARK(BM_sun_positions_locations)->Arg(1)->Arg(64)->Arg(4096);
+
 static void BM_sun_times_rust(benchmark::State &state) {
     // Perform setup here
     auto tp = floor<days>(system_clock::now());
@@ -66,5 +510,27 @@ static void BM_sun_times_rust(benchmark::State &state) {
 // Register the function as a benchmark
 BENCHMARK(BM_sun_times_rust);
 
+// The batched Rust entry point for as many locations as BM_sun_times_noaa_batch, in one call
+static void BM_sun_times_rust_batch(benchmark::State &state) {
+    // Perform setup here
+    auto tp = floor<days>(system_clock::now());
+    auto count = static_cast<std::size_t>(state.range(0));
+    std::vector<double> latitudes, longitudes;
+    for (std::size_t i = 0; i < count; i++) {
+        latitudes.push_back(lat.deg() + 0.001 * i);
+        longitudes.push_back(lon.deg() + 0.001 * i);
+    }
+    std::vector<sun_times_r> out(count);
+    auto date = date::sys_seconds(tp).time_since_epoch().count();
+    for (auto _: state) {
+        // This code gets timed
+        get_sun_times_batch_r(latitudes.data(), longitudes.data(), count, date, 1, sun::all_sun_events, out.data());
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+// Register the function as a benchmark
+BENCHMARK(BM_sun_times_rust_batch)->Arg(1)->Arg(64)->Arg(4096);
+
 // Run the benchmark
 BENCHMARK_MAIN();
@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
+
+// Time to first result of each backend, for short-lived CLI tools that are started from cron on many machines. Every
+// iteration spawns a fresh sun-startup process, which calculates one result with the backend, and waits for it to
+// exit. The time is all of that: exec, loading and relocating the libraries, dynamic initialization, the first result
+// and exit. The first_result_us counter is the part from the start of main to the first result, as sun-startup
+// measures it. BM_startup/none does nothing in there, so the other benchmarks are its time plus what their backend
+// adds. Only built where there is posix_spawn, with SUN_STARTUP_PATH set to sun-startup by CMake.
+
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <spawn.h>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+static void BM_startup(benchmark::State &state, const char *backend) {
+    // Perform setup here
+    double first_result_ns = 0;
+    for (auto _: state) {
+        // This code gets timed
+        int out[2];
+        if (::pipe(out) != 0) {
+            state.SkipWithError("pipe() failed");
+            return;
+        }
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+        posix_spawn_file_actions_addclose(&actions, out[0]);
+        char *argv[] = {const_cast<char *>(SUN_STARTUP_PATH), const_cast<char *>(backend), nullptr};
+        pid_t pid;
+        const auto spawned = posix_spawn(&pid, SUN_STARTUP_PATH, &actions, nullptr, argv, environ) == 0;
+        posix_spawn_file_actions_destroy(&actions);
+        ::close(out[1]);
+
+        std::string output;
+        char buf[64];
+        for (ssize_t n; spawned && (n = ::read(out[0], buf, sizeof(buf))) > 0;) { output.append(buf, n); }
+        ::close(out[0]);
+        int status = 0;
+        if (!spawned || ::waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            state.SkipWithError("sun-startup failed");
+            return;
+        }
+        first_result_ns += std::strtod(output.c_str(), nullptr);
+    }
+    state.counters["first_result_us"] = benchmark::Counter(first_result_ns / 1000, benchmark::Counter::kAvgIterations);
+}
+// Register the function as a benchmark
+BENCHMARK_CAPTURE(BM_startup, none, "none")->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_startup, noaa, "noaa")->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_startup, noaa_opt, "noaa_opt")->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_startup, approx_medium, "approx_medium")->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_startup, noaa_batch, "noaa_batch")->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_startup, noaa_soa, "noaa_soa")->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_startup, wiki, "wiki")->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_startup, noaa_core, "noaa_core")->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_startup, c, "c")->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_startup, rust, "rust")->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_startup, cache, "cache")->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_startup, local, "local")->Unit(benchmark::kMicrosecond)->UseRealTime();
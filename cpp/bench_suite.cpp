@@ -0,0 +1,331 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
+
+// The benchmark suite for tracking regressions between releases. Unlike the ones in bench.cpp, which time a single
+// location today, every benchmark here sweeps latitude bands, date ranges and batch sizes, on fixed dates so results
+// stay comparable. Arguments are band/days/locations, with the band name as label. Items are sun_times calculated,
+// bytes are those written as results. Run `bench --benchmark_filter=BM_suite --benchmark_out=suite.json
+// --benchmark_out_format=json` or build the bench-json target to get them as JSON.
+
+#include "rust_sun_ffi.h"
+#include "sun.h"
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+using date::days;
+
+namespace {
+    struct band {
+        const char *name;
+        double latitude;
+        double longitude;
+    };
+
+    // Kampala, Bielefeld, Rovaniemi and Vostok station. The polar circle sees the polar branches of the calculation
+    // on a few days around the solstices, Vostok on most of the year.
+    const band bands[] = {
+            {"equator", 0.31628, 32.58219},
+            {"mid_latitude", 52.02182, 8.53509},
+            {"polar_circle", 66.50394, 25.72939},
+            {"vostok", -78.463889, 106.83757},
+    };
+
+    // Locations spread over about 10 km around the center of a band, looked at for a range of days from first_day
+    struct workload {
+        const band &where;
+        date::sys_days first_day;
+        std::size_t days;
+        std::vector<sun::location> locations;
+        std::vector<Angle> latitudes;
+        std::vector<Angle> longitudes;
+
+        [[nodiscard]] std::size_t size() const { return locations.size(); }
+    };
+}// namespace
+
+static constexpr auto first_day = date::sys_days(date::January / 1 / 2023);
+
+// The arguments of all suite benchmarks: band, days and, for batches, locations
+static const std::vector<int64_t> band_args = {0, 1, 2, 3};
+static const std::vector<int64_t> day_args = {1, 365};
+static const std::vector<int64_t> batch_args = {1, 64, 4096};
+
+static auto make_workload(benchmark::State &state, std::size_t count) -> workload {
+    const auto &where = bands[state.range(0)];
+    auto res = workload{where, first_day, static_cast<std::size_t>(state.range(1)), {}, {}, {}};
+    for (std::size_t i = 0; i < count; i++) {
+        const auto location = sun::location{Angle::from_deg(where.latitude + 0.05 * std::sin(0.1 * i)),
+                                            Angle::from_deg(where.longitude + 0.05 * std::cos(0.37 * i))};
+        res.locations.push_back(location);
+        res.latitudes.push_back(location.latitude);
+        res.longitudes.push_back(location.longitude);
+    }
+    state.SetLabel(where.name);
+    return res;
+}
+
+// Runs the workload once per iteration, on the next of its days each time, and reports items and bytes
+template<typename Run>
+static void run_days(benchmark::State &state, const workload &work, std::size_t bytes_per_item, Run &&run) {
+    std::size_t day = 0;
+    for (auto _: state) {
+        // This code gets timed
+        run(work.first_day + days(day));
+        if (++day == work.days) day = 0;
+    }
+    const auto items = static_cast<int64_t>(state.iterations() * work.size());
+    state.SetItemsProcessed(items);
+    state.SetBytesProcessed(items * static_cast<int64_t>(bytes_per_item));
+}
+
+using single_backend = sun::sun_times (*)(Angle latitude, Angle longitude, date::sys_days date);
+
+// One location per call, for each backend in its own thread count
+static void BM_suite_single(benchmark::State &state, single_backend backend) {
+    // Perform setup here
+    const auto work = make_workload(state, 1);
+    const auto &location = work.locations.front();
+    run_days(state, work, sizeof(sun::sun_times), [&](date::sys_days date) {
+        benchmark::DoNotOptimize(backend(location.latitude, location.longitude, date));
+    });
+}
+// Register the function as a benchmark
+#define SUITE_SINGLE(name, ...)                                                                                        \
+    BENCHMARK_CAPTURE(BM_suite_single, name, [](Angle latitude, Angle longitude, date::sys_days date) {                \
+        return __VA_ARGS__(latitude, longitude, date);                                                                 \
+    })->ArgNames({"band", "days"})->ArgsProduct({band_args, day_args})->ThreadRange(1, 4)->UseRealTime()
+SUITE_SINGLE(wiki, sun::wiki::get_sun_times);
+SUITE_SINGLE(c, sun::get_sun_times_c);
+SUITE_SINGLE(core, sun::get_sun_times_core);
+SUITE_SINGLE(noaa, sun::noaa::get_sun_times);
+SUITE_SINGLE(noaa_opt, sun::noaa::get_sun_times_opt);
+SUITE_SINGLE(rust, sun::get_sun_times_rust);
+#undef SUITE_SINGLE
+
+// The exact NOAA backend with the noon memo shared by all threads
+static void BM_suite_single_noaa_memo(benchmark::State &state) {
+    // Perform setup here
+    static std::unique_ptr<sun::noaa::noon_memo> memo;
+    if (state.thread_index() == 0) {
+        memo = std::make_unique<sun::noaa::noon_memo>();
+        sun::noaa::use_noon_memo(memo.get());
+    }
+    const auto work = make_workload(state, 1);
+    const auto &location = work.locations.front();
+    run_days(state, work, sizeof(sun::sun_times), [&](date::sys_days date) {
+        benchmark::DoNotOptimize(sun::noaa::get_sun_times(location.latitude, location.longitude, date));
+    });
+    if (state.thread_index() == 0) {
+        sun::noaa::use_noon_memo(nullptr);
+        memo.reset();
+    }
+}
+// Register the function as a benchmark
+BENCHMARK(BM_suite_single_noaa_memo)
+        ->ArgNames({"band", "days"})
+        ->ArgsProduct({band_args, day_args})
+        ->ThreadRange(1, 4)
+        ->UseRealTime();
+
+static void BM_suite_batch_c(benchmark::State &state) {
+    // Perform setup here
+    const auto work = make_workload(state, static_cast<std::size_t>(state.range(2)));
+    std::vector<sun::sun_times> out(work.size());
+    run_days(state, work, sizeof(sun::sun_times), [&](date::sys_days date) {
+        sun::get_sun_times_c(work.locations.data(), work.size(), date, out.data());
+        benchmark::DoNotOptimize(out.data());
+    });
+}
+// Register the function as a benchmark
+BENCHMARK(BM_suite_batch_c)->ArgNames({"band", "days", "locations"})->ArgsProduct({band_args, day_args, batch_args});
+
+static void BM_suite_batch_core(benchmark::State &state) {
+    // Perform setup here
+    const auto work = make_workload(state, static_cast<std::size_t>(state.range(2)));
+    std::vector<sun::sun_times> out(work.size());
+    run_days(state, work, sizeof(sun::sun_times), [&](date::sys_days date) {
+        sun::get_sun_times_core(work.locations.data(), work.size(), date, out.data());
+        benchmark::DoNotOptimize(out.data());
+    });
+}
+// Register the function as a benchmark
+BENCHMARK(BM_suite_batch_core)
+        ->ArgNames({"band", "days", "locations"})
+        ->ArgsProduct({band_args, day_args, batch_args});
+
+static void BM_suite_batch_noaa(benchmark::State &state) {
+    // Perform setup here
+    const auto work = make_workload(state, static_cast<std::size_t>(state.range(2)));
+    std::vector<sun::sun_times> out(work.size());
+    run_days(state, work, sizeof(sun::sun_times), [&](date::sys_days date) {
+        sun::noaa::get_sun_times_batch(work.locations.data(), work.size(), date, out.data());
+        benchmark::DoNotOptimize(out.data());
+    });
+}
+// Register the function as a benchmark
+BENCHMARK(BM_suite_batch_noaa)->ArgNames({"band", "days", "locations"})->ArgsProduct({band_args, day_args, batch_args});
+
+static void BM_suite_batch_noaa_ephemeris(benchmark::State &state) {
+    // Perform setup here
+    const auto work = make_workload(state, static_cast<std::size_t>(state.range(2)));
+    const auto ephemeris = sun::noaa::daily_ephemeris(work.first_day, work.first_day + days(work.days));
+    std::vector<sun::sun_times> out(work.size());
+    run_days(state, work, sizeof(sun::sun_times), [&](date::sys_days date) {
+        sun::noaa::get_sun_times_batch(work.locations.data(), work.size(), date, out.data(), ephemeris);
+        benchmark::DoNotOptimize(out.data());
+    });
+}
+// Register the function as a benchmark
+BENCHMARK(BM_suite_batch_noaa_ephemeris)
+        ->ArgNames({"band", "days", "locations"})
+        ->ArgsProduct({band_args, day_args, batch_args});
+
+// The SoA kernel at the widest lanes this CPU has
+static void BM_suite_batch_noaa_soa(benchmark::State &state) {
+    // Perform setup here
+    const auto work = make_workload(state, static_cast<std::size_t>(state.range(2)));
+    std::vector<double> buf(sun::sun_event_count * work.size());
+    auto column = [&](std::size_t n) { return buf.data() + n * work.size(); };
+    const auto out = sun::noaa::sun_times_soa{column(0), column(1), column(2), column(3), column(4),
+                                              column(5), column(6), column(7), column(8), column(9)};
+    run_days(state, work, sun::sun_event_count * sizeof(double), [&](date::sys_days date) {
+        sun::noaa::get_sun_times_soa(work.latitudes.data(), work.longitudes.data(), work.size(), date, out);
+        benchmark::DoNotOptimize(buf.data());
+    });
+    state.counters["lanes"] = sun::noaa::simd_lanes();
+}
+// Register the function as a benchmark
+BENCHMARK(BM_suite_batch_noaa_soa)
+        ->ArgNames({"band", "days", "locations"})
+        ->ArgsProduct({band_args, day_args, batch_args});
+
+// The same in float, which fits twice the locations into a register
+static void BM_suite_batch_noaa_soa_float(benchmark::State &state) {
+    // Perform setup here
+    const auto work = make_workload(state, static_cast<std::size_t>(state.range(2)));
+    const auto latitudes = std::vector<AngleF>(work.latitudes.begin(), work.latitudes.end());
+    const auto longitudes = std::vector<AngleF>(work.longitudes.begin(), work.longitudes.end());
+    std::vector<double> buf(sun::sun_event_count * work.size());
+    auto column = [&](std::size_t n) { return buf.data() + n * work.size(); };
+    const auto out = sun::noaa::sun_times_soa{column(0), column(1), column(2), column(3), column(4),
+                                              column(5), column(6), column(7), column(8), column(9)};
+    run_days(state, work, sun::sun_event_count * sizeof(double), [&](date::sys_days date) {
+        sun::noaa::get_sun_times_soa(latitudes.data(), longitudes.data(), work.size(), date, out);
+        benchmark::DoNotOptimize(buf.data());
+    });
+    state.counters["lanes"] = 2 * sun::noaa::simd_lanes();
+}
+// Register the function as a benchmark
+BENCHMARK(BM_suite_batch_noaa_soa_float)
+        ->ArgNames({"band", "days", "locations"})
+        ->ArgsProduct({band_args, day_args, batch_args});
+
+static void BM_suite_batch_rust(benchmark::State &state) {
+    // Perform setup here
+    const auto work = make_workload(state, static_cast<std::size_t>(state.range(2)));
+    std::vector<double> latitudes, longitudes;
+    for (const auto &location: work.locations) {
+        latitudes.push_back(location.latitude.deg());
+        longitudes.push_back(location.longitude.deg());
+    }
+    std::vector<sun_times_r> out(work.size());
+    run_days(state, work, sizeof(sun_times_r), [&](date::sys_days date) {
+        get_sun_times_batch_r(latitudes.data(), longitudes.data(), work.size(),
+                              date::sys_seconds(date).time_since_epoch().count(), 1, sun::all_sun_events, out.data());
+        benchmark::DoNotOptimize(out.data());
+    });
+}
+// Register the function as a benchmark
+BENCHMARK(BM_suite_batch_rust)->ArgNames({"band", "days", "locations"})->ArgsProduct({band_args, day_args, batch_args});
+
+// All days of the range for each location in one call, so one iteration covers days * locations items
+static void BM_suite_range_noaa(benchmark::State &state) {
+    // Perform setup here
+    const auto work = make_workload(state, static_cast<std::size_t>(state.range(2)));
+    std::vector<sun::sun_times> out(work.days);
+    for (auto _: state) {
+        // This code gets timed
+        for (const auto &location: work.locations) {
+            sun::noaa::get_sun_times_range(location.latitude, location.longitude, work.first_day, work.days,
+                                           out.data());
+            benchmark::DoNotOptimize(out.data());
+        }
+    }
+    const auto items = static_cast<int64_t>(state.iterations() * work.size() * work.days);
+    state.SetItemsProcessed(items);
+    state.SetBytesProcessed(items * static_cast<int64_t>(sizeof(sun::sun_times)));
+    state.SetLabel(work.where.name);
+}
+// Register the function as a benchmark
+BENCHMARK(BM_suite_range_noaa)->ArgNames({"band", "days", "locations"})->ArgsProduct({band_args, {30, 365}, {1, 64}});
+
+// The whole range of days for all locations into one table, split up between threads
+static void BM_suite_grid_noaa(benchmark::State &state) {
+    // Perform setup here
+    const auto work = make_workload(state, static_cast<std::size_t>(state.range(2)));
+    const auto threads = static_cast<unsigned>(state.range(3));
+    auto table = sun::sun_times_table(work.size(), work.first_day, work.days);
+    for (auto _: state) {
+        // This code gets timed
+        sun::noaa::get_sun_times_grid(work.latitudes.data(), work.longitudes.data(), table, threads);
+    }
+    const auto items = static_cast<int64_t>(state.iterations() * work.size() * work.days);
+    state.SetItemsProcessed(items);
+    state.SetBytesProcessed(items * static_cast<int64_t>(sizeof(sun::packed_sun_times)));
+}
+// Register the function as a benchmark
+BENCHMARK(BM_suite_grid_noaa)
+        ->ArgNames({"band", "days", "locations", "threads"})
+        ->ArgsProduct({band_args, {30, 365}, {1024}, {1, 2, 4}})
+        ->UseRealTime();
+
+// All events of the range for all locations, taken from one schedule in time order. Items are events here, so this
+// is the pop and refill throughput, with the setup of the schedule spread over the days.
+static void BM_suite_schedule_noaa(benchmark::State &state) {
+    // Perform setup here
+    const auto work = make_workload(state, static_cast<std::size_t>(state.range(2)));
+    const auto from = date::sys_seconds(work.first_day);
+    const auto until = date::sys_seconds(work.first_day + days(work.days));
+    std::vector<sun::noaa::site_event> out;
+    int64_t events = 0;
+    for (auto _: state) {
+        // This code gets timed
+        auto schedule = sun::noaa::event_schedule(work.locations.data(), work.size(), from);
+        out.clear();
+        events += static_cast<int64_t>(schedule.pop_until(until, out));
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(events);
+    state.SetBytesProcessed(events * static_cast<int64_t>(sizeof(sun::noaa::site_event)));
+}
+// Register the function as a benchmark
+BENCHMARK(BM_suite_schedule_noaa)
+        ->ArgNames({"band", "days", "locations"})
+        ->ArgsProduct({band_args, {1, 30}, {64, 4096}});
+
+// Lookups through a cache with cells of about a kilometer shared by all threads. With more days, the cache gets
+// colder, because each day has its own entries.
+static void BM_suite_cache_noaa(benchmark::State &state) {
+    // Perform setup here
+    static std::unique_ptr<sun::noaa::sun_times_cache> cache;
+    if (state.thread_index() == 0) cache = std::make_unique<sun::noaa::sun_times_cache>(Angle::from_deg(0.01));
+    const auto work = make_workload(state, static_cast<std::size_t>(state.range(2)));
+    run_days(state, work, sizeof(sun::sun_times), [&](date::sys_days date) {
+        for (const auto &location: work.locations) {
+            benchmark::DoNotOptimize(cache->get(location.latitude, location.longitude, date));
+        }
+    });
+    if (state.thread_index() == 0) {
+        const auto lookups = cache->hits() + cache->misses();
+        state.counters["hit_rate"] = lookups ? static_cast<double>(cache->hits()) / static_cast<double>(lookups) : 0;
+        cache.reset();
+    }
+}
+// Register the function as a benchmark
+BENCHMARK(BM_suite_cache_noaa)
+        ->ArgNames({"band", "days", "locations"})
+        ->ArgsProduct({band_args, day_args, {64, 4096}})
+        ->ThreadRange(1, 4)
+        ->UseRealTime();
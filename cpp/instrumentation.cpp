@@ -0,0 +1,134 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
+
+// The registry behind the counters in instrumentation.h.
+
+#include "instrumentation.h"
+#include "sun.h"
+#include <cinttypes>
+#include <mutex>
+
+using sun::instrumentation::counter;
+using sun::instrumentation::counter_count;
+using sun::instrumentation::detail::thread_counters;
+
+namespace {
+    struct counter_info {
+        const char *name;
+        const char *help;
+        // Counted in nanoseconds, with a name ending in _ns, but exported in seconds
+        bool time;
+    };
+
+    // All live threads with counters, and what the exited ones counted
+    struct registry {
+        std::mutex lock;
+        thread_counters *threads = nullptr;
+        std::array<std::uint64_t, counter_count> exited{};
+    };
+}// namespace
+
+static constexpr counter_info infos[counter_count] = {
+        {"noaa_sun_time", "Single events calculated by noaa::get_sun_time", false},
+        {"noaa_sun_times", "Sets of sun_times calculated by the other NOAA functions", false},
+        {"noaa_equation_of_time", "Evaluations of the equation of time by the NOAA backend", false},
+        {"noaa_sun_declination", "Evaluations of the sun declination by the NOAA backend", false},
+        {"noaa_missing_events", "Events that don't happen on their day with the NOAA backend", false},
+        {"wiki_sun_time", "Single events calculated by wiki::get_sun_time", false},
+        {"wiki_missing_events", "Events that don't happen on their day with the wiki backend", false},
+        {"redshift_sun_times", "Locations calculated by the redshift code", false},
+        {"redshift_missing_events", "Events that don't happen on their day with the redshift code", false},
+        {"redshift_call_ns", "Time spent in the redshift code", true},
+        {"redshift_convert_ns", "Time spent converting arguments and results for the redshift code", true},
+        {"rust_sun_times", "Locations calculated by the Rust code", false},
+        {"rust_missing_events", "Events that don't happen on their day with the Rust code", false},
+        {"rust_call_ns", "Time spent in the Rust code", true},
+        {"rust_convert_ns", "Time spent converting arguments and results for the Rust code", true},
+};
+
+// Never destroyed, as threads may exit after the end of main
+static auto the_registry() -> registry & {
+    static auto *res = new registry;
+    return *res;
+}
+
+std::atomic<sun::instrumentation::trace_hook> sun::instrumentation::detail::active_hook{nullptr};
+
+thread_counters::thread_counters() {
+    auto &r = the_registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    next = r.threads;
+    r.threads = this;
+}
+
+thread_counters::~thread_counters() {
+    auto &r = the_registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    for (std::size_t i = 0; i < counter_count; i++) { r.exited[i] += values[i].load(std::memory_order_relaxed); }
+    for (auto **it = &r.threads; *it; it = &(*it)->next) {
+        if (*it == this) {
+            *it = next;
+            break;
+        }
+    }
+}
+
+auto sun::instrumentation::collect() -> snapshot {
+    auto &r = the_registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    snapshot res{r.exited};
+    for (auto *t = r.threads; t; t = t->next) {
+        for (std::size_t i = 0; i < counter_count; i++) {
+            res.values[i] += t->values[i].load(std::memory_order_relaxed);
+        }
+    }
+    return res;
+}
+
+void sun::instrumentation::reset() {
+    auto &r = the_registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    r.exited = {};
+    for (auto *t = r.threads; t; t = t->next) {
+        for (auto &value: t->values) { value.store(0, std::memory_order_relaxed); }
+    }
+}
+
+auto sun::instrumentation::name_of(counter c) -> const char * { return infos[static_cast<std::size_t>(c)].name; }
+
+auto sun::instrumentation::prometheus() -> std::string {
+    const auto values = collect();
+    std::string res;
+    char value[32];
+    for (std::size_t i = 0; i < counter_count; i++) {
+        const auto &info = infos[i];
+        auto name = std::string("sun_") + info.name;
+        if (info.time) {
+            name.replace(name.size() - 3, 3, "_seconds");
+            std::snprintf(value, sizeof(value), "%.9f", static_cast<double>(values.values[i]) * 1e-9);
+        } else {
+            std::snprintf(value, sizeof(value), "%" PRIu64, values.values[i]);
+        }
+        name += "_total";
+        res += "# HELP " + name + " " + info.help + "\n# TYPE " + name + " counter\n" + name + " " + value + "\n";
+    }
+    return res;
+}
+
+void sun::instrumentation::dump(std::FILE *file) {
+    const auto values = collect();
+    for (std::size_t i = 0; i < counter_count; i++) {
+        std::fprintf(file, "%s %" PRIu64 "\n", infos[i].name, values.values[i]);
+    }
+}
+
+auto sun::instrumentation::detail::missing_events(const sun_times &times) -> std::uint64_t {
+    std::uint64_t res = 0;
+    for (auto event: {sun_event::astro_dawn, sun_event::naut_dawn, sun_event::civil_dawn, sun_event::sunrise,
+                       sun_event::sunset, sun_event::civil_dusk, sun_event::naut_dusk, sun_event::astro_dusk}) {
+        if (times.has(event) && !(times.*noaa::detail::member_of(event))) res++;
+    }
+    return res;
+}
+
+void sun::instrumentation::set_trace_hook(trace_hook hook) { detail::active_hook.store(hook); }
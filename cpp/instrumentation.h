@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
+
+// Optional counters in the hot paths of the backends. They are only compiled in with SUN_INSTRUMENTATION defined,
+// which the CMake option of the same name does for the sun library and everything linking it. Without it, the
+// SUN_COUNT and SUN_TIME macros expand to nothing and all counters stay zero.
+
+#ifndef SOLAR_CALCULATIONS_INSTRUMENTATION_H
+#define SOLAR_CALCULATIONS_INSTRUMENTATION_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace sun {
+    struct sun_times;
+}
+
+namespace sun::instrumentation {
+#ifdef SUN_INSTRUMENTATION
+    constexpr bool enabled = true;
+#else
+    constexpr bool enabled = false;
+#endif
+
+    enum class counter : std::size_t {
+        // Single events calculated by noaa::get_sun_time, including those for noaa::get_sun_times
+        noaa_sun_time,
+        // Sets of sun_times calculated by the other NOAA functions, one per location and day
+        noaa_sun_times,
+        // Evaluations of the equation of time and the sun declination, exactly, per date or from the ephemeris
+        noaa_equation_of_time,
+        noaa_sun_declination,
+        // Events that don't happen on their day, the polar branch of the calculation. Not counted by the SIMD kernel
+        // of get_sun_times_soa, which has no branch for them.
+        noaa_missing_events,
+        wiki_sun_time,
+        wiki_missing_events,
+        // Locations calculated by the redshift code, and the time spent in the C code and converting for it
+        redshift_sun_times,
+        redshift_missing_events,
+        redshift_call_ns,
+        redshift_convert_ns,
+        // Calls into the Rust code, and the time spent there and converting for it
+        rust_sun_times,
+        rust_missing_events,
+        rust_call_ns,
+        rust_convert_ns,
+    };
+    constexpr std::size_t counter_count = static_cast<std::size_t>(counter::rust_convert_ns) + 1;
+
+    // The counters of all threads, summed up, including the ones that have exited.
+    struct snapshot {
+        std::array<std::uint64_t, counter_count> values{};
+
+        std::uint64_t operator[](counter c) const { return values[static_cast<std::size_t>(c)]; }
+    };
+    snapshot collect();
+
+    // Sets all counters of all threads back to zero. Counts of other threads that happen meanwhile may get lost.
+    void reset();
+
+    // Returns the name of a counter, like "noaa_sun_time".
+    const char *name_of(counter c);
+
+    // Returns all counters in the Prometheus text format, as sun_<name>_total, with the times in seconds.
+    std::string prometheus();
+
+    // Writes one line "<name> <value>" per counter to file.
+    void dump(std::FILE *file);
+
+    // Called at the end of each timed section, like the calls into the C and Rust code, with its counter and
+    // duration. Also only with SUN_INSTRUMENTATION. The hook has to be safe to call from any thread.
+    using trace_hook = void (*)(counter c, std::chrono::nanoseconds duration);
+    void set_trace_hook(trace_hook hook);
+
+    namespace detail {
+        // The counters of one thread. Only that thread writes them, other threads read them for collect().
+        struct thread_counters {
+            thread_counters();
+            ~thread_counters();
+            thread_counters(const thread_counters &) = delete;
+            thread_counters &operator=(const thread_counters &) = delete;
+
+            std::array<std::atomic<std::uint64_t>, counter_count> values{};
+            thread_counters *next = nullptr;
+        };
+
+        inline thread_local thread_counters local_counters;
+
+        // A plain load and store instead of an atomic increment, as nobody else writes them
+        inline void add(counter c, std::uint64_t n) {
+            auto &value = local_counters.values[static_cast<std::size_t>(c)];
+            value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        // Returns how many of the events in times.events are nullopt
+        std::uint64_t missing_events(const sun_times &times);
+
+        extern std::atomic<trace_hook> active_hook;
+
+        // Adds the nanoseconds of its lifetime to a counter
+        struct scoped_timer {
+            explicit scoped_timer(counter c) : c(c), start(std::chrono::steady_clock::now()) {}
+            ~scoped_timer() {
+                const auto duration = std::chrono::steady_clock::now() - start;
+                const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration);
+                add(c, static_cast<std::uint64_t>(ns.count()));
+                if (auto hook = active_hook.load(std::memory_order_relaxed)) hook(c, ns);
+            }
+            scoped_timer(const scoped_timer &) = delete;
+            scoped_timer &operator=(const scoped_timer &) = delete;
+
+            counter c;
+            std::chrono::steady_clock::time_point start;
+        };
+    }// namespace detail
+}// namespace sun::instrumentation
+
+#ifdef SUN_INSTRUMENTATION
+// Adds n to the counter c of this thread
+#define SUN_COUNT_N(c, n) ::sun::instrumentation::detail::add(::sun::instrumentation::counter::c, (n))
+#define SUN_COUNT(c) SUN_COUNT_N(c, 1)
+// Adds the events of the sun_times times that don't happen to the counter c
+#define SUN_COUNT_MISSING(c, times) SUN_COUNT_N(c, ::sun::instrumentation::detail::missing_events(times))
+// Times the rest of the enclosing scope into the counter c
+#define SUN_TIME(c) const ::sun::instrumentation::detail::scoped_timer sun_timer_##c(::sun::instrumentation::counter::c)
+#else
+#define SUN_COUNT_N(c, n) ((void) 0)
+#define SUN_COUNT(c) ((void) 0)
+#define SUN_COUNT_MISSING(c, times) ((void) 0)
+#define SUN_TIME(c) ((void) 0)
+#endif
+
+#endif//SOLAR_CALCULATIONS_INSTRUMENTATION_H
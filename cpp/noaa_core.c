@@ -0,0 +1,249 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
+
+// The NOAA spreadsheet calculation like in noaa_sun.cpp, without anything from the C library but <stdint.h> and
+// <stddef.h>. Locations go through it in blocks, every step for all of a block at once, and nothing in these steps
+// branches on a value: events that don't happen are NaN until they are stored. So the compiler is free to vectorize
+// the steps, like GCC and Clang do at -O3.
+
+#include "noaa_core.h"
+
+#define PI 3.14159265358979323846
+#define DEG (PI / 180.0)
+
+// pi/2 in two parts, the first with its lower bits zero, so reducing by a multiple of it stays exact for a while
+#define PIO2_HI 1.57079632673412561417e+00
+#define PIO2_LO 6.07710050650619224932e-11
+
+// Seconds from the start of the julian period to the epoch, and days from there to J2000.0
+#define EPOCH_JULIAN_SECONDS 210866760000.0
+#define J2000_JULIAN_DAYS 2451545.0
+
+// Locations per block of the batch. Every block takes this many doubles of stack for each of its seven columns.
+#ifndef NOAA_CORE_BLOCK
+#define NOAA_CORE_BLOCK 16
+#endif
+
+// Adding 1.5 * 2^52 rounds to an integer, which is then in the low bits of the mantissa. Only for |x| < 2^51.
+#define ROUND_BIAS 6755399441055744.0
+
+typedef union {
+    double d;
+    uint64_t u;
+} bits;
+
+static const bits quiet_nan = {UINT64_C(0x7ff8000000000000)};
+
+// Only for |x| < 2^51, which all angles and times here are far below
+static inline double floor_of(double x) {
+    const double i = (x + ROUND_BIAS) - ROUND_BIAS;
+    return i > x ? i - 1.0 : i;
+}
+
+// Taylor series up to x^13 and x^14, good to 2e-14 for |x| <= pi/4
+static inline double sin_poly(double x) {
+    const double z = x * x;
+    return x * (1.0 + z * (-1.0 / 6 + z * (1.0 / 120 + z * (-1.0 / 5040 + z * (1.0 / 362880 +
+           z * (-1.0 / 39916800 + z * (1.0 / 6227020800.0)))))));
+}
+
+static inline double cos_poly(double x) {
+    const double z = x * x;
+    return 1.0 + z * (-1.0 / 2 + z * (1.0 / 24 + z * (-1.0 / 720 + z * (1.0 / 40320 + z * (-1.0 / 3628800 +
+           z * (1.0 / 479001600.0 + z * (-1.0 / 87178291200.0)))))));
+}
+
+// Returns x reduced to [-pi/4, pi/4] by a multiple of pi/2, and that multiple modulo 4 in quadrant
+static inline double reduce(double x, unsigned *quadrant) {
+    bits n;
+    n.d = x * (2.0 / PI) + ROUND_BIAS;
+    *quadrant = (unsigned) n.u & 3u;
+    const double q = n.d - ROUND_BIAS;
+    return (x - q * PIO2_HI) - q * PIO2_LO;
+}
+
+// Both polynomials are evaluated and one is picked, which is cheaper than a branch once it is vectorized
+static inline double core_sin(double x) {
+    unsigned quadrant;
+    const double r = reduce(x, &quadrant);
+    const double v = quadrant & 1u ? cos_poly(r) : sin_poly(r);
+    return quadrant & 2u ? -v : v;
+}
+
+static inline double core_cos(double x) {
+    unsigned quadrant;
+    const double r = reduce(x, &quadrant);
+    const double v = quadrant & 1u ? sin_poly(r) : cos_poly(r);
+    return (quadrant + 1u) & 2u ? -v : v;
+}
+
+// Newton's method from half the exponent, which is within 6% and takes five steps to double precision. 0 for x <= 0.
+static inline double core_sqrt(double x) {
+    bits guess;
+    const double a = x > 0.0 ? x : 1.0;
+    guess.d = a;
+    guess.u = (guess.u >> 1) + (UINT64_C(1023) << 51);
+    double y = guess.d;
+    for (int i = 0; i < 5; i++) { y = 0.5 * (y + a / y); }
+    return x > 0.0 ? y : 0.0;
+}
+
+// Taylor series up to x^27, good to 1.3e-11 for |x| <= 0.5. The coefficients are (2n)! / (4^n n!^2 (2n + 1)).
+static inline double asin_poly(double x) {
+    static const double c[] = {
+            1.0,
+            0.16666666666666666,
+            0.075,
+            0.044642857142857144,
+            0.030381944444444444,
+            0.022372159090909092,
+            0.017352764423076924,
+            0.01396484375,
+            0.011551800896139705,
+            0.009761609529194078,
+            0.008390335809616815,
+            0.0073125258735988454,
+            0.006447210311889649,
+            0.005740037670841924,
+    };
+    const double z = x * x;
+    double r = 0.0;
+    for (int i = sizeof(c) / sizeof(c[0]) - 1; i >= 0; i--) { r = r * z + c[i]; }
+    return x * r;
+}
+
+// Only for |x| <= 1. Above 0.5, from acos(x) = 2 asin(sqrt((1 - x) / 2)), which keeps the precision close to 1,
+// where the hour angles of polar latitudes are. Negative x from acos(x) = pi - acos(-x).
+static inline double core_acos(double x) {
+    const double a = x < 0.0 ? -x : x;
+    const int outer = a > 0.5;
+    const double p = asin_poly(outer ? core_sqrt(0.5 * (1.0 - a)) : a);
+    const double r = outer ? 2.0 * p : PI / 2 - p;
+    return x < 0.0 ? PI - r : r;
+}
+
+// The terms of the sheet, in julian centuries since J2000.0
+static inline double mean_longitude(double t) {
+    const double l = 280.46646 + t * (36000.76983 + t * 0.0003032);
+    return (l - 360.0 * floor_of(l / 360.0)) * DEG;
+}
+
+static inline double mean_anomaly(double t) { return (357.52911 + t * (35999.05029 - 0.0001537 * t)) * DEG; }
+
+static inline double obliquity_correction(double t) {
+    const double mean = 23 + (26 + ((21.448 - t * (46.815 + t * (0.00059 - t * 0.001813)))) / 60) / 60;
+    return (mean + 0.00256 * core_cos((125.04 - 1934.136 * t) * DEG)) * DEG;
+}
+
+static inline double sin_declination(double t) {
+    const double m = mean_anomaly(t);
+    const double center = core_sin(m) * (1.914602 - t * (0.004817 + 0.000014 * t)) +
+                          core_sin(2 * m) * (0.019993 - 0.000101 * t) + core_sin(3 * m) * 0.000289;
+    const double omega = (125.04 - 1934.136 * t) * DEG;
+    const double apparent = mean_longitude(t) + (center - 0.00569 - 0.00478 * core_sin(omega)) * DEG;
+    return core_sin(obliquity_correction(t)) * core_sin(apparent);
+}
+
+static inline double equation_of_time(double t) {
+    const double oc = obliquity_correction(t);
+    const double l = mean_longitude(t);
+    const double m = mean_anomaly(t);
+    const double e = 0.016708634 - t * (0.000042037 + 0.0000001267 * t);
+    const double tan_oc = core_sin(oc / 2) / core_cos(oc / 2);
+    const double y = tan_oc * tan_oc;
+    return y * core_sin(2 * l) - 2 * e * core_sin(m) + 4 * e * y * core_sin(m) * core_cos(2 * l) -
+           0.5 * y * y * core_sin(4 * l) - 1.25 * e * e * core_sin(2 * m);
+}
+
+// The hour angle of an elevation at julian day j, or NaN if it isn't reached then. The declination only comes in
+// through its sine and cosine, so there is no asin.
+static inline double hour_angle(double sin_lat, double cos_lat, double j, double cos_elevation) {
+    const double sin_decl = sin_declination(j / 36525.0);
+    const double cos_decl = core_sqrt(1.0 - sin_decl * sin_decl);
+    const double x = (cos_elevation - sin_lat * sin_decl) / (cos_lat * cos_decl);
+    // Also false for NaN
+    const int reached = x >= -1.0 && x <= 1.0;
+    const double angle = core_acos(reached ? x : 0.0);
+    return reached ? angle : quiet_nan.d;
+}
+
+// The cosine of the elevation of each event from astronomical dawn on as it is used in the hour angle, which is
+// -sin() of the twilight elevation below the horizon for both dawn and dusk
+static const double cos_elevations[NOAA_CORE_EVENT_COUNT] = {
+        0.0,
+        0.0,
+        -0.3090169943749474,
+        -0.20791169081775934,
+        -0.10452846326765347,
+        -0.01453808050249695,
+        -0.01453808050249695,
+        -0.10452846326765347,
+        -0.20791169081775934,
+        -0.3090169943749474,
+};
+
+// The second of midnight + days, or NOAA_CORE_NONE for NaN
+static inline int64_t seconds_of(double midnight, double days) {
+    return days == days ? (int64_t) floor_of((midnight + days) * 86400.0) : NOAA_CORE_NONE;
+}
+
+void noaa_core_sun_times_batch(const double *latitude, const double *longitude, size_t count, int64_t day,
+                               uint32_t mask, int64_t *times, size_t site_stride, size_t event_stride) {
+    const int64_t date = day / 86400 - (day % 86400 < 0);
+    const double midnight = (double) date;
+    const double j_day = ((double) date * 86400.0 + EPOCH_JULIAN_SECONDS) / 86400.0 - J2000_JULIAN_DAYS;
+
+    for (size_t first = 0; first < count; first += NOAA_CORE_BLOCK) {
+        const size_t n = count - first < NOAA_CORE_BLOCK ? count - first : NOAA_CORE_BLOCK;
+        int64_t *const out = times + first * site_stride;
+        double sin_lat[NOAA_CORE_BLOCK], cos_lat[NOAA_CORE_BLOCK], lon[NOAA_CORE_BLOCK];
+        double j_noon[NOAA_CORE_BLOCK], noon[NOAA_CORE_BLOCK], tp[NOAA_CORE_BLOCK], days[NOAA_CORE_BLOCK];
+
+        for (size_t i = 0; i < n; i++) {
+            sin_lat[i] = core_sin(latitude[first + i] * DEG);
+            cos_lat[i] = core_cos(latitude[first + i] * DEG);
+            lon[i] = longitude[first + i] * DEG;
+        }
+
+        // Noon from the longitude, corrected by the equation of time in two passes
+        for (size_t i = 0; i < n; i++) {
+            double eq_of_time = equation_of_time((j_day + (PI - lon[i]) / (2 * PI)) / 36525.0);
+            eq_of_time = equation_of_time((j_day + (PI - lon[i] - eq_of_time) / (2 * PI)) / 36525.0);
+            noon[i] = (PI - lon[i] - eq_of_time) / (2 * PI);
+            j_noon[i] = j_day + noon[i];
+        }
+        for (size_t i = 0; i < n; i++) {
+            out[i * site_stride + NOAA_CORE_NOON * event_stride] = seconds_of(midnight, noon[i]);
+            out[i * site_stride + NOAA_CORE_MIDNIGHT * event_stride] = seconds_of(midnight, noon[i] + 0.5);
+        }
+
+        // The two passes of the sheet for each event, starting from noon
+        for (int e = NOAA_CORE_ASTRO_DAWN; e < NOAA_CORE_EVENT_COUNT; e++) {
+            int64_t *const row = out + e * event_stride;
+            if (!(mask & (1u << e))) {
+                for (size_t i = 0; i < n; i++) { row[i * site_stride] = NOAA_CORE_NONE; }
+                continue;
+            }
+            const double cos_elevation = cos_elevations[e];
+            const double side = e < NOAA_CORE_SUNSET ? -1.0 / (2 * PI) : 1.0 / (2 * PI);
+            for (size_t i = 0; i < n; i++) {
+                tp[i] = j_noon[i] + side * hour_angle(sin_lat[i], cos_lat[i], j_noon[i], cos_elevation);
+            }
+            for (size_t i = 0; i < n; i++) {
+                const double eq_of_time = equation_of_time(tp[i] / 36525.0);
+                const double angle = hour_angle(sin_lat[i], cos_lat[i], tp[i], cos_elevation);
+                days[i] = (PI - lon[i] - eq_of_time) / (2 * PI) + side * angle;
+            }
+            for (size_t i = 0; i < n; i++) { row[i * site_stride] = seconds_of(midnight, days[i]); }
+        }
+    }
+}
+
+uint32_t noaa_core_sun_times(double latitude, double longitude, int64_t day, uint32_t mask, int64_t *times) {
+    noaa_core_sun_times_batch(&latitude, &longitude, 1, day, mask, times, NOAA_CORE_EVENT_COUNT, 1);
+    uint32_t res = 0;
+    for (int e = 0; e < NOAA_CORE_EVENT_COUNT; e++) {
+        if (times[e] != NOAA_CORE_NONE) res |= 1u << e;
+    }
+    return res;
+}
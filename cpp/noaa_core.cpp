@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
+
+#include "noaa_core.h"
+#include "sun.h"
+#include <algorithm>
+
+using date::sys_seconds;
+using std::optional;
+using std::chrono::seconds;
+
+// noaa_core_event and sun_event share the same order, so the masks are the same, too.
+static_assert(NOAA_CORE_EVENT_COUNT == sun::sun_event_count && NOAA_CORE_ALL_EVENTS == sun::all_sun_events);
+
+static auto day_of(date::sys_days date) -> std::int64_t {
+    return std::chrono::duration_cast<seconds>(date.time_since_epoch()).count();
+}
+
+// Maps the NOAA_CORE_EVENT_COUNT times of a location
+static auto sun_times_of(const std::int64_t *times, sun::sun_event_mask events) -> sun::sun_times {
+    auto map = [&](int e) -> optional<sys_seconds> {
+        if (times[e] != NOAA_CORE_NONE) return sys_seconds(seconds(times[e]));
+        else
+            return std::nullopt;
+    };
+    return {
+            sys_seconds(seconds(times[NOAA_CORE_NOON])),
+            sys_seconds(seconds(times[NOAA_CORE_MIDNIGHT])),
+            map(NOAA_CORE_ASTRO_DAWN),
+            map(NOAA_CORE_NAUT_DAWN),
+            map(NOAA_CORE_CIVIL_DAWN),
+            map(NOAA_CORE_SUNRISE),
+            map(NOAA_CORE_SUNSET),
+            map(NOAA_CORE_CIVIL_DUSK),
+            map(NOAA_CORE_NAUT_DUSK),
+            map(NOAA_CORE_ASTRO_DUSK),
+            events,
+    };
+}
+
+auto sun::get_sun_times_core(Angle latitude, Angle longitude, date::sys_days date, sun_event_mask events)
+        -> sun_times {
+    std::int64_t times[NOAA_CORE_EVENT_COUNT];
+    events = (events & all_sun_events) | sun_event::noon | sun_event::midnight;
+    noaa_core_sun_times(latitude.deg(), longitude.deg(), day_of(date), events, times);
+    return sun_times_of(times, events);
+}
+
+void sun::get_sun_times_core(const location *locations, std::size_t count, date::sys_days date, sun_times *out,
+                             sun_event_mask events) {
+    // Chunks of locations go through the batch, so the times stay small enough for the cache
+    constexpr std::size_t chunk = 256;
+    double latitudes[chunk], longitudes[chunk];
+    std::int64_t times[NOAA_CORE_EVENT_COUNT * chunk];
+    events = (events & all_sun_events) | sun_event::noon | sun_event::midnight;
+    const auto day = day_of(date);
+    for (std::size_t first = 0; first < count; first += chunk) {
+        const auto n = std::min(chunk, count - first);
+        for (std::size_t i = 0; i < n; i++) {
+            latitudes[i] = locations[first + i].latitude.deg();
+            longitudes[i] = locations[first + i].longitude.deg();
+        }
+        noaa_core_sun_times_batch(latitudes, longitudes, n, day, events, times, NOAA_CORE_EVENT_COUNT, 1);
+        for (std::size_t i = 0; i < n; i++) {
+            out[first + i] = sun_times_of(times + i * NOAA_CORE_EVENT_COUNT, events);
+        }
+    }
+}
@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
+
+#include "angle.h"
+#include "instrumentation.h"
+#include "julian_date.h"
+#include "noaa_terms.h"
+#include "sun.h"
+
+using date::sys_seconds;
+using julian_date::julian_century;
+using julian_date::julian_centuries;
+using julian_date::julian_day;
+using julian_date::julian_days;
+
+sun::noaa::daily_ephemeris::daily_ephemeris(date::sys_days first_day, date::sys_days last_day,
+                                            unsigned samples_per_day) {
+    constexpr auto start_of_julian_century = julian_days{2451545.0};
+    // Events of a date happen up to a day before or after its midnight UTC, so cover one more day on each side, plus
+    // the samples the interpolation needs beyond that.
+    const auto first = first_day - date::days(2);
+    const auto days = last_day < first_day ? 0 : (last_day - first_day).count() + 5;
+
+    start = julian_day(julian_date::sys_to_julian(sys_seconds(first))) - start_of_julian_century;
+    samples_per_century = 36525.0 * samples_per_day;
+    samples.resize(static_cast<std::size_t>(days) * samples_per_day + 1);
+    for (std::size_t i = 0; i < samples.size(); i++) {
+        const auto tp = start + julian_centuries(i / samples_per_century);
+        samples[i] = {::equation_of_time(tp).rad(), ::sun_declination(tp).rad()};
+    }
+}
+
+// Cubic interpolation through the samples before and after the two around tp. At the sample spacing, that is exact to
+// far below a millisecond, while linear interpolation is off enough to move events close to the poles by seconds.
+static auto interpolate(double p0, double p1, double p2, double p3, double f) -> double {
+    return p1 + 0.5 * f * (p2 - p0 + f * (2 * p0 - 5 * p1 + 4 * p2 - p3 + f * (3 * (p1 - p2) + p3 - p0)));
+}
+
+auto sun::noaa::daily_ephemeris::find(julian_century tp, double &fraction) const -> const sample * {
+    const auto x = (tp - start).count() * samples_per_century;
+    const auto i = floor(x);
+    // Also rejects NaN
+    if (!(i >= 1 && i + 2 < static_cast<double>(samples.size()))) return nullptr;
+    fraction = x - i;
+    return &samples[static_cast<std::size_t>(i)];
+}
+
+auto sun::noaa::daily_ephemeris::equation_of_time(julian_century tp) const -> Angle {
+    double f;
+    if (auto s = find(tp, f)) {
+        SUN_COUNT(noaa_equation_of_time);
+        return Angle::from_rad(interpolate(s[-1].eq_of_time, s[0].eq_of_time, s[1].eq_of_time, s[2].eq_of_time, f));
+    } else {
+        return ::equation_of_time(tp);
+    }
+}
+
+auto sun::noaa::daily_ephemeris::sun_declination(julian_century tp) const -> Angle {
+    double f;
+    if (auto s = find(tp, f)) {
+        SUN_COUNT(noaa_sun_declination);
+        return Angle::from_rad(
+                interpolate(s[-1].declination, s[0].declination, s[1].declination, s[2].declination, f));
+    } else {
+        return ::sun_declination(tp);
+    }
+}
@@ -0,0 +1,142 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
+
+// The lock-free noon memo, see noon_memo in sun.h.
+
+#include "noaa_terms.h"
+#include "sun.h"
+#include <atomic>
+#include <cstring>
+
+namespace {
+    // One entry of the memo. version is odd while a writer changes the others, and zero if it was never written, so
+    // a reader knows that what it read is consistent if version is even, non-zero and the same before and after.
+    struct alignas(32) memo_entry {
+        std::atomic<std::uint32_t> version{0};
+        mutable std::atomic<std::uint32_t> referenced{0};
+        std::atomic<std::int64_t> day{0};
+        std::atomic<std::uint64_t> longitude{0};
+        std::atomic<std::uint64_t> noon{0};
+    };
+}// namespace
+
+struct alignas(64) sun::noaa::noon_memo::set {
+    memo_entry ways[2];
+};
+
+// Hits and misses are counted in a few places on their own cache lines, so threads don't fight over one counter.
+struct alignas(64) sun::noaa::noon_memo::counter {
+    std::atomic<std::uint64_t> hits{0};
+    std::atomic<std::uint64_t> misses{0};
+};
+
+static constexpr std::size_t counter_count = 16;
+
+static std::atomic<sun::noaa::noon_memo *> active_memo{nullptr};
+
+static auto bits_of(double value) -> std::uint64_t {
+    std::uint64_t res;
+    std::memcpy(&res, &value, sizeof(res));
+    return res;
+}
+
+static auto double_of(std::uint64_t bits) -> double {
+    double res;
+    std::memcpy(&res, &bits, sizeof(res));
+    return res;
+}
+
+static auto hash_of(std::int64_t day, std::uint64_t longitude) -> std::uint64_t {
+    auto h = longitude ^ static_cast<std::uint64_t>(day) * 0x9e3779b97f4a7c15;
+    h ^= h >> 31;
+    h *= 0xbf58476d1ce4e5b9;
+    return h ^ h >> 29;
+}
+
+static auto sets_for(std::size_t capacity) -> std::size_t {
+    std::size_t sets = 1;
+    while (sets * 2 < capacity) { sets *= 2; }
+    return sets;
+}
+
+sun::noaa::noon_memo::noon_memo(std::size_t capacity) : sets(sets_for(capacity)), counters(counter_count) {}
+
+sun::noaa::noon_memo::~noon_memo() {
+    // Don't leave a dangling memo behind
+    auto self = this;
+    active_memo.compare_exchange_strong(self, nullptr);
+}
+
+auto sun::noaa::noon_memo::find(date::sys_days date, Angle longitude) const -> std::optional<double> {
+    const auto day = static_cast<std::int64_t>(date.time_since_epoch().count());
+    const auto lon = bits_of(longitude.rad());
+    const auto index = hash_of(day, lon) & (sets.size() - 1);
+    auto &count = counters[index % counter_count];
+
+    for (auto &entry: sets[index].ways) {
+        const auto before = entry.version.load(std::memory_order_acquire);
+        if (before == 0 || before & 1) continue;
+        const auto entry_day = entry.day.load(std::memory_order_relaxed);
+        const auto entry_lon = entry.longitude.load(std::memory_order_relaxed);
+        const auto noon = entry.noon.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (entry.version.load(std::memory_order_relaxed) != before) continue;
+
+        if (entry_day == day && entry_lon == lon) {
+            // Only written if it changes, to keep the cache line shared between readers
+            if (!entry.referenced.load(std::memory_order_relaxed)) entry.referenced.store(1, std::memory_order_relaxed);
+            count.hits.fetch_add(1, std::memory_order_relaxed);
+            return double_of(noon);
+        }
+    }
+    count.misses.fetch_add(1, std::memory_order_relaxed);
+    return std::nullopt;
+}
+
+void sun::noaa::noon_memo::insert(date::sys_days date, Angle longitude, double noon) {
+    const auto day = static_cast<std::int64_t>(date.time_since_epoch().count());
+    const auto lon = bits_of(longitude.rad());
+    auto &ways = sets[hash_of(day, lon) & (sets.size() - 1)].ways;
+
+    // Second chance: replace an entry that is empty or wasn't read since it was stored. If both were read, both get
+    // another chance and the day picks which one goes.
+    auto *victim = &ways[day & 1];
+    if (ways[0].version.load(std::memory_order_relaxed) == 0 || !ways[0].referenced.load(std::memory_order_relaxed)) {
+        victim = &ways[0];
+    } else if (ways[1].version.load(std::memory_order_relaxed) == 0 ||
+               !ways[1].referenced.load(std::memory_order_relaxed)) {
+        victim = &ways[1];
+    } else {
+        ways[0].referenced.store(0, std::memory_order_relaxed);
+        ways[1].referenced.store(0, std::memory_order_relaxed);
+    }
+
+    auto version = victim->version.load(std::memory_order_relaxed);
+    if (version & 1 || !victim->version.compare_exchange_strong(version, version + 1, std::memory_order_acquire))
+        return;
+    std::atomic_thread_fence(std::memory_order_release);
+    victim->day.store(day, std::memory_order_relaxed);
+    victim->longitude.store(lon, std::memory_order_relaxed);
+    victim->noon.store(bits_of(noon), std::memory_order_relaxed);
+    victim->referenced.store(0, std::memory_order_relaxed);
+    // Never back to zero, which means empty
+    victim->version.store(version + 2 == 0 ? 2 : version + 2, std::memory_order_release);
+}
+
+auto sun::noaa::noon_memo::capacity() const -> std::size_t { return sets.size() * 2; }
+
+auto sun::noaa::noon_memo::hits() const -> std::uint64_t {
+    std::uint64_t res = 0;
+    for (auto &c: counters) { res += c.hits.load(std::memory_order_relaxed); }
+    return res;
+}
+
+auto sun::noaa::noon_memo::misses() const -> std::uint64_t {
+    std::uint64_t res = 0;
+    for (auto &c: counters) { res += c.misses.load(std::memory_order_relaxed); }
+    return res;
+}
+
+void sun::noaa::use_noon_memo(noon_memo *memo) { active_memo.store(memo, std::memory_order_release); }
+
+auto active_noon_memo() -> sun::noaa::noon_memo * { return active_memo.load(std::memory_order_acquire); }
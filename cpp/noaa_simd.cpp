@@ -0,0 +1,723 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
+
+// Structure-of-arrays variant of the NOAA calculation. It evaluates the same two-pass sheet as get_sun_times_batch, but
+// on a block of locations at once and with branch-free sin/cos/acos. All the math below is written once for a lane
+// type V, which is either a plain double or float, or a GCC/Clang vector of them, so one block maps to one vector
+// register. The vector variants are compiled for the matching instruction sets and picked at runtime.
+//
+// float lanes hold twice as many locations per register. The slow terms of the date stay in double, and the lanes
+// only handle the small offsets from them: centuries from the middle of the day and days from midnight, which is
+// where float has enough digits. Only the sum with the date in the event times is done in double again.
+
+#include "angle.h"
+#include "julian_date.h"
+#include "noaa_terms.h"
+#include "sun.h"
+#include <type_traits>
+
+using date::sys_seconds;
+using julian_date::julian_day;
+using julian_date::julian_days;
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SUN_ALWAYS_INLINE inline __attribute__((always_inline))
+#define SUN_NOINLINE __attribute__((noinline))
+#define SUN_VECTOR_TYPES
+#else
+#define SUN_ALWAYS_INLINE inline
+#define SUN_NOINLINE
+#endif
+
+#if defined(SUN_VECTOR_TYPES) && defined(__x86_64__)
+#define SUN_SIMD_X86
+#define SUN_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+#ifdef SUN_VECTOR_TYPES
+typedef double double2 __attribute__((vector_size(2 * sizeof(double))));
+typedef double double4 __attribute__((vector_size(4 * sizeof(double))));
+typedef double double8 __attribute__((vector_size(8 * sizeof(double))));
+typedef double double16 __attribute__((vector_size(16 * sizeof(double))));
+typedef float float4 __attribute__((vector_size(4 * sizeof(float))));
+typedef float float8 __attribute__((vector_size(8 * sizeof(float))));
+typedef float float16 __attribute__((vector_size(16 * sizeof(float))));
+#endif
+
+// The element type of a lane type
+template<class V, class = void>
+struct scalar_type {
+    using type = V;
+};
+
+template<class V>
+struct scalar_type<V, std::void_t<decltype(std::declval<V>()[0])>> {
+    using type = std::decay_t<decltype(std::declval<V>()[0])>;
+};
+
+template<class V>
+using scalar_t = typename scalar_type<V>::type;
+
+template<class V>
+static constexpr std::size_t lanes_of = sizeof(V) / sizeof(scalar_t<V>);
+
+// The lane type of the given element type and size in bytes, and the double lane type as wide as a float one
+template<class S, std::size_t Bytes>
+struct vector_type;
+
+template<class V>
+struct wide_type {
+    using type = double;
+};
+
+#ifdef SUN_VECTOR_TYPES
+template<>
+struct vector_type<double, 16> {
+    using type = double2;
+};
+template<>
+struct vector_type<double, 32> {
+    using type = double4;
+};
+template<>
+struct vector_type<double, 64> {
+    using type = double8;
+};
+template<>
+struct vector_type<float, 16> {
+    using type = float4;
+};
+template<>
+struct vector_type<float, 32> {
+    using type = float8;
+};
+template<>
+struct vector_type<float, 64> {
+    using type = float16;
+};
+
+template<>
+struct wide_type<double2> {
+    using type = double2;
+};
+template<>
+struct wide_type<double4> {
+    using type = double4;
+};
+template<>
+struct wide_type<double8> {
+    using type = double8;
+};
+template<>
+struct wide_type<float4> {
+    using type = double4;
+};
+template<>
+struct wide_type<float8> {
+    using type = double8;
+};
+template<>
+struct wide_type<float16> {
+    using type = double16;
+};
+#endif
+
+template<class S, std::size_t Bytes>
+using vector_t = typename vector_type<S, Bytes>::type;
+
+template<class V>
+using wide_t = typename wide_type<V>::type;
+
+template<class V, class F>
+static SUN_ALWAYS_INLINE V gather(F &&lane) {
+    if constexpr (std::is_arithmetic_v<V>) {
+        return lane(0);
+    } else {
+        V v;
+        for (std::size_t i = 0; i < lanes_of<V>; i++) { v[i] = lane(i); }
+        return v;
+    }
+}
+
+template<class V>
+static SUN_ALWAYS_INLINE scalar_t<V> lane(V v, std::size_t i) {
+    if constexpr (std::is_arithmetic_v<V>) {
+        return v;
+    } else {
+        return v[i];
+    }
+}
+
+// Converts float lanes to double lanes, and leaves double lanes alone
+template<class V>
+static SUN_ALWAYS_INLINE wide_t<V> widen(V v) {
+    if constexpr (std::is_arithmetic_v<V> || std::is_same_v<V, wide_t<V>>) {
+        return v;
+    } else {
+        return __builtin_convertvector(v, wide_t<V>);
+    }
+}
+
+template<class V>
+static SUN_ALWAYS_INLINE V sqrt_any(V v) {
+    if constexpr (std::is_arithmetic_v<V>) {
+        return std::sqrt(v);
+    } else {
+        // With -fno-math-errno this becomes a single vector sqrt instruction.
+        for (std::size_t i = 0; i < lanes_of<V>; i++) {
+            if constexpr (std::is_same_v<scalar_t<V>, float>) {
+                v[i] = __builtin_sqrtf(v[i]);
+            } else {
+                v[i] = __builtin_sqrt(v[i]);
+            }
+        }
+        return v;
+    }
+}
+
+// Rounds to the nearest integer for |x| < 2^51, or 2^22 in float. Unlike nearbyint() this never ends up as a libm
+// call, which targets without a rounding instruction would need.
+template<class V>
+static SUN_ALWAYS_INLINE V round_int(V x) {
+    using S = scalar_t<V>;
+    constexpr S magic = std::is_same_v<S, float> ? S(12582912.0) : S(6755399441055744.0);// 1.5 * 2^23, 1.5 * 2^52
+    return (x + magic) - magic;
+}
+
+template<class V>
+static SUN_ALWAYS_INLINE V floor_int(V x) {
+    V r = round_int(x);
+    return r > x ? r - scalar_t<V>(1) : r;
+}
+
+// sin and cos of an angle in degrees. The argument is reduced to [-45°, 45°] in degrees first, which is exact because
+// multiples of 90 are integers, and then evaluated with the Cephes minimax polynomials (error below 1e-16 there). In
+// float, the higher terms just don't matter.
+template<class V>
+static SUN_ALWAYS_INLINE void sincos_deg(V deg, V &s, V &c) {
+    using S = scalar_t<V>;
+    V q = round_int<V>(deg * S(1.0 / 90.0));
+    V r = (deg - q * S(90)) * S(M_PI / 180.0);
+    V quadrant = q - S(4) * round_int<V>((q - S(1.5)) * S(0.25));
+
+    V z = r * r;
+    V sr = r + r * z *
+                       (S(-1.66666666666666307295e-1) +
+                        z * (S(8.33333333332211858878e-3) +
+                             z * (S(-1.98412698295895385996e-4) +
+                                  z * (S(2.75573136213857245213e-6) +
+                                       z * (S(-2.50507477628578072866e-8) + z * S(1.58962301576546568060e-10))))));
+    V cr = S(1) - S(0.5) * z +
+           z * z *
+                   (S(4.16666666666665929218e-2) +
+                    z * (S(-1.38888888888730564116e-3) +
+                         z * (S(2.48015872888517045348e-5) +
+                              z * (S(-2.75573141792967388112e-7) +
+                                   z * (S(2.08757008419747316778e-9) + z * S(-1.13585365213876817300e-11))))));
+
+    // odd and upper are 0 or 1: sin is negative in the upper half, cos in the second and third quadrant.
+    V odd = quadrant - S(2) * round_int<V>((quadrant - S(0.5)) * S(0.5));
+    V upper = (quadrant - odd) * S(0.5);
+    V cos_negative = odd + upper - S(2) * odd * upper;
+    s = (odd != S(0) ? cr : sr) * (S(1) - S(2) * upper);
+    c = (odd != S(0) ? sr : cr) * (S(1) - S(2) * cos_negative);
+}
+
+// The rational approximation of (asin(x) - x) / x^3 in x^2 from fdlibm's e_asin.c.
+template<class V>
+static SUN_ALWAYS_INLINE V asin_rational(V z) {
+    using S = scalar_t<V>;
+    V p = z * (S(1.66666666666666657415e-01) +
+               z * (S(-3.25565818622400915405e-01) +
+                    z * (S(2.01212532134862925881e-01) +
+                         z * (S(-4.00555345006794114027e-02) +
+                              z * (S(7.91534994289814532176e-04) + z * S(3.47933107596021167570e-05))))));
+    V q = S(1) + z * (S(-2.40339491173441421878e+00) +
+                      z * (S(2.02094576023350569471e+00) +
+                           z * (S(-6.88283971605453293030e-01) + z * S(7.70381505559019352791e-02))));
+    return p / q;
+}
+
+// acos with both of fdlibm's ranges evaluated and selected afterwards. Like acos(), it returns NaN for |x| > 1, which
+// is exactly how a lane reports an event that doesn't happen.
+template<class V>
+static SUN_ALWAYS_INLINE V acos_any(V x) {
+    using S = scalar_t<V>;
+    V ax = x < S(0) ? -x : x;
+    V small = S(M_PI_2) - (x + x * asin_rational(x * x));
+
+    // acos(|x|) = 2 * asin(sqrt((1 - |x|) / 2)), mirrored for negative x
+    V z = (S(1) - ax) * S(0.5);
+    V s = sqrt_any(z);
+    V big = S(2) * (s + s * asin_rational(z));
+    big = x < S(0) ? S(M_PI) - big : big;
+
+    return ax < S(0.5) ? small : big;
+}
+
+// date_terms in the element type of the lanes. In float, the mean anomaly is taken modulo 360° in double first: it is
+// in the thousands of degrees, where a float is only good to a thousandth of one.
+template<class S>
+struct lane_terms {
+    explicit lane_terms(const date_terms &terms)
+        : t(S(terms.t0.time_since_epoch().count())), mean_lon(S(terms.mean_lon)),
+          mean_anom(S(std::is_same_v<S, float> ? fmod(terms.mean_anom, 360.0) : terms.mean_anom)),
+          ecc(S(terms.ecc)), center1(S(terms.center1)), center2(S(terms.center2)), aberration(S(terms.aberration)),
+          sin_oc(S(terms.sin_oc)), y(S(terms.y)) {}
+
+    S t;
+    S mean_lon;
+    S mean_anom;
+    S ecc;
+    S center1;
+    S center2;
+    S aberration;
+    S sin_oc;
+    S y;
+};
+
+// The per-location part of date_terms::equation_of_time and date_terms::sun_declination, at x days after midnight.
+// Everything is derived from the sine and cosine of the mean longitude and anomaly.
+template<class V>
+struct sun_state {
+    V eq_of_time;
+    V sin_decl;
+};
+
+template<class V>
+static SUN_ALWAYS_INLINE V mean_longitude(const lane_terms<scalar_t<V>> &terms, V dt) {
+    using S = scalar_t<V>;
+    return terms.mean_lon + dt * (S(36000.76983) + S(0.0003032) * (S(2) * terms.t + dt));
+}
+
+template<class V>
+static SUN_ALWAYS_INLINE V mean_anomaly(const lane_terms<scalar_t<V>> &terms, V dt) {
+    using S = scalar_t<V>;
+    return terms.mean_anom + dt * (S(35999.05029) - S(0.0001537) * (S(2) * terms.t + dt));
+}
+
+template<class V>
+static SUN_ALWAYS_INLINE V equation_of_time(const lane_terms<scalar_t<V>> &terms, V sl, V cl, V sm, V cm) {
+    using S = scalar_t<V>;
+    V sin2l = S(2) * sl * cl;
+    V cos2l = S(1) - S(2) * sl * sl;
+    V sin4l = S(2) * sin2l * cos2l;
+    V sin2m = S(2) * sm * cm;
+    auto y = terms.y;
+    auto e = terms.ecc;
+    return y * sin2l - S(2) * e * sm + S(4) * e * y * sm * cos2l - S(0.5) * y * y * sin4l - S(1.25) * e * e * sin2m;
+}
+
+template<class V>
+static SUN_ALWAYS_INLINE V eq_of_time_at(const lane_terms<scalar_t<V>> &terms, V x) {
+    using S = scalar_t<V>;
+    V dt = (x - S(0.5)) / S(36525);
+    V sl, cl, sm, cm;
+    sincos_deg(mean_longitude(terms, dt), sl, cl);
+    sincos_deg(mean_anomaly(terms, dt), sm, cm);
+    return equation_of_time(terms, sl, cl, sm, cm);
+}
+
+template<class V>
+static SUN_ALWAYS_INLINE sun_state<V> sun_state_at(const lane_terms<scalar_t<V>> &terms, V x) {
+    using S = scalar_t<V>;
+    V dt = (x - S(0.5)) / S(36525);
+    V l = mean_longitude(terms, dt);
+    V sl, cl, sm, cm;
+    sincos_deg(l, sl, cl);
+    sincos_deg(mean_anomaly(terms, dt), sm, cm);
+
+    V sin3m = sm * (S(3) - S(4) * sm * sm);
+    V center = sm * terms.center1 + S(2) * sm * cm * terms.center2 + sin3m * S(0.000289);
+    V sal, cal;
+    sincos_deg<V>(l + center - terms.aberration, sal, cal);
+
+    return {equation_of_time(terms, sl, cl, sm, cm), terms.sin_oc * sal};
+}
+
+// acos() is never negative, so multiplying by the sign of the elevation does what copysign() does in noaa_sun.cpp.
+template<class V>
+static SUN_ALWAYS_INLINE V hour_angle(scalar_t<V> cos_elev, scalar_t<V> sign, V sin_lat, V cos_lat, V sin_decl) {
+    V cos_decl = sqrt_any<V>(scalar_t<V>(1) - sin_decl * sin_decl);
+    return sign * acos_any<V>((cos_elev - sin_lat * sin_decl) / (cos_lat * cos_decl));
+}
+
+namespace {
+    // Writes the event times as seconds since the epoch into the columns of a sun_times_soa.
+    struct seconds_sink {
+        double *columns[sun::sun_event_count];
+
+        template<class V>
+        SUN_ALWAYS_INLINE void operator()(sun::sun_event event, std::size_t first, V seconds) const {
+            auto dst = columns[static_cast<std::size_t>(event)] + first;
+            for (std::size_t i = 0; i < lanes_of<V>; i++) { dst[i] = lane(seconds, i); }
+        }
+    };
+
+    // Writes the event times packed like packed_sun_times into the rows of a sun_times_table.
+    struct packed_sink {
+        std::int32_t *columns[sun::sun_event_count];
+        double midnight;
+
+        template<class V>
+        SUN_ALWAYS_INLINE void operator()(sun::sun_event event, std::size_t first, V seconds) const {
+            auto dst = columns[static_cast<std::size_t>(event)] + first;
+            V since_midnight = seconds - midnight;
+            for (std::size_t i = 0; i < lanes_of<V>; i++) {
+                auto s = lane(since_midnight, i);
+                dst[i] = s == s ? static_cast<std::int32_t>(s) : sun::packed_sun_times::none;
+            }
+        }
+    };
+
+    // Sinks always get the seconds as double lanes, whatever S is.
+    template<class Sink, class S>
+    struct kernel_args {
+        using scalar = S;
+
+        const basic_angle<S> *latitude;
+        const basic_angle<S> *longitude;
+        std::size_t count;
+        double date;
+        lane_terms<S> terms;
+        Sink out;
+    };
+
+    struct elevation_consts {
+        double cos_elev;
+        double sign;
+    };
+
+    // The cosine of the SunTime angle of an event, from the table in sun.h
+    constexpr double cos_of(sun::sun_event event) { return sun::sun_event_trig[static_cast<std::size_t>(event)].cos; }
+}// namespace
+
+static constexpr elevation_consts elevations[] = {
+        {cos_of(sun::sun_event::astro_dawn), -1.0}, {cos_of(sun::sun_event::naut_dawn), -1.0},
+        {cos_of(sun::sun_event::civil_dawn), -1.0}, {cos_of(sun::sun_event::sunrise), -1.0},
+        {cos_of(sun::sun_event::sunset), 1.0},      {cos_of(sun::sun_event::civil_dusk), 1.0},
+        {cos_of(sun::sun_event::naut_dusk), 1.0},   {cos_of(sun::sun_event::astro_dusk), 1.0},
+};
+
+// One block of lanes_of<V> locations starting at first.
+template<class V, class Sink>
+static SUN_ALWAYS_INLINE void kernel_block(const kernel_args<Sink, scalar_t<V>> &a, std::size_t first) {
+    using S = scalar_t<V>;
+    const auto &terms = a.terms;
+    auto lat = gather<V>([&](std::size_t i) { return a.latitude[first + i].deg(); });
+    auto lon = gather<V>([&](std::size_t i) { return a.longitude[first + i].rad(); });
+    V sin_lat, cos_lat;
+    sincos_deg(lat, sin_lat, cos_lat);
+
+    // Same two passes as time_of_solar_noon, in days from midnight
+    V x = (S(M_PI) - lon) / S(2 * M_PI);
+    x = (S(M_PI) - lon - eq_of_time_at(terms, x)) / S(2 * M_PI);
+    V noon = (S(M_PI) - lon - eq_of_time_at(terms, x)) / S(2 * M_PI);
+
+    auto noon_day = a.date + widen(noon);
+    a.out(sun::sun_event::noon, first, floor_int(noon_day * 86400.0));
+    a.out(sun::sun_event::midnight, first, floor_int((noon_day + 0.5) * 86400.0));
+    V sin_decl = sun_state_at(terms, noon).sin_decl;
+
+    // elevations[] is in event order, starting at astro_dawn
+    for (std::size_t e = 0; e < 8; e++) {
+        const auto cos_elev = S(elevations[e].cos_elev);
+        const auto sign = S(elevations[e].sign);
+
+        // Same two passes as time_of_solar_elevation
+        V tp = noon + hour_angle(cos_elev, sign, sin_lat, cos_lat, sin_decl) / S(2 * M_PI);
+        auto state = sun_state_at(terms, tp);
+        V angle = hour_angle(cos_elev, sign, sin_lat, cos_lat, state.sin_decl);
+        V offset = (S(M_PI) - lon - state.eq_of_time + angle) / S(2 * M_PI);
+        const auto event = static_cast<sun::sun_event>(static_cast<std::size_t>(sun::sun_event::astro_dawn) + e);
+        a.out(event, first, floor_int((a.date + widen(offset)) * 86400.0));
+    }
+}
+
+// Solar elevation over a day for elevation_sampler::fill, with the slow terms as quadratics in the day fraction x.
+namespace {
+    struct elevation_job {
+        using scalar = double;
+
+        std::size_t count;
+        double x0;
+        double dx;
+        double longitude;
+        double sin_lat;
+        double cos_lat;
+        const double *eq_of_time;
+        const double *sin_decl;
+        const double *cos_decl;
+        Angle *out;
+    };
+}// namespace
+
+template<class V>
+static SUN_ALWAYS_INLINE V quadratic(const double *c, V x) {
+    return c[0] + x * (c[1] + x * c[2]);
+}
+
+template<class V>
+static SUN_ALWAYS_INLINE void kernel_block(const elevation_job &job, std::size_t first) {
+    V x = gather<V>([&](std::size_t i) { return job.x0 + static_cast<double>(first + i) * job.dx; });
+    V hour_angle = (job.longitude + quadratic(job.eq_of_time, x)) * (180.0 / M_PI) + 360.0 * x - 180.0;
+    V sin_ha, cos_ha;
+    sincos_deg(hour_angle, sin_ha, cos_ha);
+
+    // Clamped, as rounding may push this just past 1 with the sun in the zenith
+    V c = cos_ha * job.cos_lat * quadratic(job.cos_decl, x) + job.sin_lat * quadratic(job.sin_decl, x);
+    c = c > 1.0 ? c - c + 1.0 : c;
+    c = c < -1.0 ? c - c - 1.0 : c;
+    V elevation = acos_any(c);
+    for (std::size_t i = 0; i < lanes_of<V>; i++) { job.out[first + i] = Angle::from_rad(lane(elevation, i)); }
+}
+
+// Stores the elevation and azimuth of the direction to the sun, given as its components up, east and north
+template<class V>
+static SUN_ALWAYS_INLINE void store_position(V up, V east, V north, const sun::noaa::sun_positions_soa &out,
+                                             std::size_t first) {
+    using S = scalar_t<V>;
+    up = up > S(1) ? up - up + S(1) : up;
+    up = up < S(-1) ? up - up - S(1) : up;
+
+    // The azimuth from the cosine of its angle to north and the side of east it's on. The horizontal part is 0 with
+    // the sun in the zenith or nadir, where this makes it north.
+    V horizontal = sqrt_any(east * east + north * north);
+    V c = horizontal > S(0) ? north / horizontal : horizontal - horizontal + S(1);
+    c = c > S(1) ? c - c + S(1) : c;
+    c = c < S(-1) ? c - c - S(1) : c;
+    V azimuth = acos_any(c);
+    azimuth = east < S(0) ? S(2 * M_PI) - azimuth : azimuth;
+
+    V elevation = acos_any(up);
+    for (std::size_t i = 0; i < lanes_of<V>; i++) {
+        out.elevation[first + i] = Angle::from_rad(lane(elevation, i));
+        out.azimuth[first + i] = Angle::from_rad(lane(azimuth, i));
+    }
+}
+
+// sun_positions of one location at time points of one day, for elevation_sampler::fill. The time points are either
+// x0 + i * dx days after midnight, or time_points[i] if that is set.
+namespace {
+    struct position_job {
+        using scalar = double;
+
+        std::size_t count;
+        double x0;
+        double dx;
+        const sys_seconds *time_points;
+        double midnight;
+        double longitude;
+        double sin_lat;
+        double cos_lat;
+        const double *eq_of_time;
+        const double *sin_decl;
+        const double *cos_decl;
+        sun::noaa::sun_positions_soa out;
+
+        double x_of(std::size_t i) const {
+            if (time_points) return static_cast<double>(time_points[i].time_since_epoch().count()) / 86400.0 - midnight;
+            return x0 + static_cast<double>(i) * dx;
+        }
+    };
+}// namespace
+
+template<class V>
+static SUN_ALWAYS_INLINE void kernel_block(const position_job &job, std::size_t first) {
+    V x = gather<V>([&](std::size_t i) { return job.x_of(first + i); });
+    V hour_angle = (job.longitude + quadratic(job.eq_of_time, x)) * (180.0 / M_PI) + 360.0 * x - 180.0;
+    V sin_ha, cos_ha;
+    sincos_deg(hour_angle, sin_ha, cos_ha);
+
+    V sin_decl = quadratic(job.sin_decl, x), cos_decl = quadratic(job.cos_decl, x);
+    V up = cos_ha * job.cos_lat * cos_decl + job.sin_lat * sin_decl;
+    V east = -cos_decl * sin_ha;
+    V north = sin_decl * job.cos_lat - cos_decl * cos_ha * job.sin_lat;
+    store_position(up, east, north, job.out, first);
+}
+
+// sun_positions of many locations at one time point, where the declination and the hour angle without the longitude
+// are the same for all of them
+namespace {
+    struct locations_position_job {
+        using scalar = double;
+
+        std::size_t count;
+        const Angle *latitude;
+        const Angle *longitude;
+        // In degrees
+        double hour_angle;
+        double sin_decl;
+        double cos_decl;
+        sun::noaa::sun_positions_soa out;
+    };
+}// namespace
+
+template<class V>
+static SUN_ALWAYS_INLINE void kernel_block(const locations_position_job &job, std::size_t first) {
+    V lat = gather<V>([&](std::size_t i) { return job.latitude[first + i].deg(); });
+    V lon = gather<V>([&](std::size_t i) { return job.longitude[first + i].deg(); });
+    V sin_lat, cos_lat, sin_ha, cos_ha;
+    sincos_deg(lat, sin_lat, cos_lat);
+    sincos_deg(lon + job.hour_angle, sin_ha, cos_ha);
+
+    V up = cos_ha * cos_lat * job.cos_decl + sin_lat * job.sin_decl;
+    V east = -job.cos_decl * sin_ha;
+    V north = job.sin_decl * cos_lat - job.cos_decl * cos_ha * sin_lat;
+    store_position(up, east, north, job.out, first);
+}
+
+// The runners work on any job with a count, a scalar type and a kernel_block overload.
+// The single lane block stays out of line, so the compiler doesn't vectorize the scalar variant across calls.
+template<class Job>
+static SUN_NOINLINE void kernel_single(const Job &a, std::size_t i) {
+    kernel_block<typename Job::scalar>(a, i);
+}
+
+template<class Job>
+static void run_scalar(const Job &a) {
+    for (std::size_t i = 0; i < a.count; i++) { kernel_single(a, i); }
+}
+
+#ifdef SUN_VECTOR_TYPES
+template<class V, class Job>
+static SUN_ALWAYS_INLINE void run_blocks(const Job &a) {
+    std::size_t i = 0;
+    for (; i + lanes_of<V> <= a.count; i += lanes_of<V>) { kernel_block<V>(a, i); }
+    for (; i < a.count; i++) { kernel_single(a, i); }
+}
+#endif
+
+#ifdef SUN_SIMD_X86
+template<class Job>
+static void run_sse2(const Job &a) {
+    run_blocks<vector_t<typename Job::scalar, 16>>(a);
+}
+
+template<class Job>
+SUN_TARGET("avx2,fma") static void run_avx2(const Job &a) {
+    run_blocks<vector_t<typename Job::scalar, 32>>(a);
+}
+
+template<class Job>
+SUN_TARGET("avx512f") static void run_avx512(const Job &a) {
+    run_blocks<vector_t<typename Job::scalar, 64>>(a);
+}
+#elif defined(SUN_VECTOR_TYPES) && defined(__ARM_NEON)
+template<class Job>
+static void run_neon(const Job &a) {
+    run_blocks<vector_t<typename Job::scalar, 16>>(a);
+}
+#endif
+
+// lanes counts elements of the job's scalar type, so a float job fills a register with twice as many.
+template<class Job>
+static void run(const Job &args, unsigned lanes) {
+    constexpr unsigned per_double = sizeof(double) / sizeof(typename Job::scalar);
+    const auto max_lanes = sun::noaa::simd_lanes() == 1 ? 1 : sun::noaa::simd_lanes() * per_double;
+    if (lanes == 0 || lanes > max_lanes) { lanes = max_lanes; }
+
+#ifdef SUN_SIMD_X86
+    if (lanes >= 8 * per_double) return run_avx512(args);
+    if (lanes >= 4 * per_double) return run_avx2(args);
+    if (lanes >= 2 * per_double) return run_sse2(args);
+#elif defined(SUN_VECTOR_TYPES) && defined(__ARM_NEON)
+    if (lanes >= 2 * per_double) return run_neon(args);
+#endif
+    run_scalar(args);
+}
+
+unsigned sun::noaa::simd_lanes() {
+#ifdef SUN_SIMD_X86
+    static const unsigned lanes = __builtin_cpu_supports("avx512f") ? 8 : __builtin_cpu_supports("avx2") ? 4 : 2;
+    return lanes;
+#elif defined(SUN_VECTOR_TYPES) && defined(__ARM_NEON)
+    return 2;
+#else
+    return 1;
+#endif
+}
+
+static auto j_day_of(date::sys_days date) {
+    constexpr auto start_of_julian_century = julian_days{2451545.0};
+    return julian_day(julian_date::sys_to_julian(sys_seconds(date))) - start_of_julian_century;
+}
+
+template<class T>
+void sun::noaa::get_sun_times_soa(const basic_angle<T> *latitude, const basic_angle<T> *longitude, std::size_t count,
+                                  date::sys_days date, const sun_times_soa &out, unsigned lanes) {
+    const auto sink = seconds_sink{{out.noon, out.midnight, out.astro_dawn, out.naut_dawn, out.civil_dawn, out.sunrise,
+                                    out.sunset, out.civil_dusk, out.naut_dusk, out.astro_dusk}};
+    const auto days = static_cast<double>(date.time_since_epoch().count());
+    const auto terms = lane_terms<T>(date_terms(j_day_of(date)));
+    SUN_COUNT_N(noaa_sun_times, count);
+    run(kernel_args<seconds_sink, T>{latitude, longitude, count, days, terms, sink}, lanes);
+}
+
+template<class T>
+void sun::noaa::get_sun_times_soa(const basic_angle<T> *latitude, const basic_angle<T> *longitude,
+                                  sun_times_table &table, std::size_t day, unsigned lanes) {
+    get_sun_times_soa(latitude, longitude, 0, table.locations(), table, day, lanes);
+}
+
+template<class T>
+void sun::noaa::get_sun_times_soa(const basic_angle<T> *latitude, const basic_angle<T> *longitude, std::size_t first,
+                                  std::size_t count, sun_times_table &table, std::size_t day, unsigned lanes) {
+    auto sink = packed_sink{};
+    for (std::size_t e = 0; e < sun_event_count; e++) {
+        sink.columns[e] = table.row(static_cast<sun_event>(e), day) + first;
+    }
+    const auto date = table.date_of(day);
+    const auto days = static_cast<double>(date.time_since_epoch().count());
+    sink.midnight = days * 86400.0;
+    const auto terms = lane_terms<T>(date_terms(j_day_of(date)));
+    SUN_COUNT_N(noaa_sun_times, count);
+    run(kernel_args<packed_sink, T>{latitude + first, longitude + first, count, days, terms, sink}, lanes);
+}
+
+template void sun::noaa::get_sun_times_soa(const Angle *, const Angle *, std::size_t, date::sys_days,
+                                           const sun_times_soa &, unsigned);
+template void sun::noaa::get_sun_times_soa(const Angle *, const Angle *, sun_times_table &, std::size_t, unsigned);
+template void sun::noaa::get_sun_times_soa(const Angle *, const Angle *, std::size_t, std::size_t, sun_times_table &,
+                                           std::size_t, unsigned);
+template void sun::noaa::get_sun_times_soa(const AngleF *, const AngleF *, std::size_t, date::sys_days,
+                                           const sun_times_soa &, unsigned);
+template void sun::noaa::get_sun_times_soa(const AngleF *, const AngleF *, sun_times_table &, std::size_t, unsigned);
+template void sun::noaa::get_sun_times_soa(const AngleF *, const AngleF *, std::size_t, std::size_t, sun_times_table &,
+                                           std::size_t, unsigned);
+
+void sun::noaa::elevation_sampler::fill(date::sys_seconds first, std::chrono::seconds step, std::size_t count,
+                                        Angle *out) const {
+    const auto x0 = static_cast<double>(first.time_since_epoch().count()) / 86400.0 - midnight;
+    const auto dx = static_cast<double>(step.count()) / 86400.0;
+    run(elevation_job{count, x0, dx, longitude, sin_lat, cos_lat, eq_of_time, sin_decl, cos_decl, out}, 0);
+}
+
+void sun::noaa::elevation_sampler::fill(date::sys_seconds first, std::chrono::seconds step, std::size_t count,
+                                        const sun_positions_soa &out) const {
+    const auto x0 = static_cast<double>(first.time_since_epoch().count()) / 86400.0 - midnight;
+    const auto dx = static_cast<double>(step.count()) / 86400.0;
+    run(position_job{count, x0, dx, nullptr, midnight, longitude, sin_lat, cos_lat, eq_of_time, sin_decl, cos_decl,
+                     out},
+        0);
+}
+
+void sun::noaa::elevation_sampler::fill(const date::sys_seconds *time_points, std::size_t count,
+                                        const sun_positions_soa &out) const {
+    run(position_job{count, 0, 0, time_points, midnight, longitude, sin_lat, cos_lat, eq_of_time, sin_decl, cos_decl,
+                     out},
+        0);
+}
+
+void sun::noaa::get_sun_positions(const Angle *latitude, const Angle *longitude, std::size_t count,
+                                  date::sys_seconds time_point, const sun_positions_soa &out) {
+    constexpr auto start_of_julian_century = julian_days{2451545.0};
+    const auto j_tp = julian_day(julian_date::sys_to_julian(time_point)) - start_of_julian_century;
+
+    // The hour angle as in get_sun_position, but without the longitude, which every lane adds on its own
+    const auto day = date::floor<date::days>(time_point);
+    const auto minutes_from_midnight = Angle(julian_days(time_point - day));
+    const auto hour_angle = ::equation_of_time(j_tp) + minutes_from_midnight - Angle::from_deg(180);
+    const auto decl = ::sun_declination(j_tp);
+    run(locations_position_job{count, latitude, longitude, hour_angle.deg(), sin(decl), cos(decl), out}, 0);
+}
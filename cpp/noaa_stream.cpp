@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
+
+// The events of a location as one ordered stream, read from get_sun_times_opt a day at a time, and of many
+// locations merged into one.
+
+#include "sun.h"
+#include <algorithm>
+
+using date::sys_seconds;
+using std::optional;
+
+// After that many days without an event of the mask, the stream assumes it never happens
+static constexpr int max_idle_days = 2 * 366;
+
+sun::noaa::event_stream::event_stream(Angle latitude, Angle longitude, sys_seconds from, sun_event_mask events)
+    : latitude(latitude), longitude(longitude), from(from), mask(events & all_sun_events),
+      // The events of a date are within 12 hours of its noon, which is within a day of midnight UTC for longitudes
+      // from -180° to 180°, so the day before the one of from may still have some of them.
+      next_date(std::chrono::floor<date::days>(from) - date::days(1)) {}
+
+auto sun::noaa::event_stream::next() -> optional<timed_event> {
+    while (!count || pending[count - 1].time >= bound) {
+        if (!mask || (!count && idle_days > max_idle_days)) return std::nullopt;
+        read_day();
+    }
+    return pending[--count];
+}
+
+void sun::noaa::event_stream::read_day() {
+    const auto times = get_sun_times_opt(latitude, longitude, next_date, mask);
+    auto added = false;
+    auto add = [&](sun_event event, sys_seconds time) {
+        if (!(mask & mask_of(event)) || time < from) return;
+        // Sorted into the pending events, which are latest first, so everything returned before it moves up
+        const auto comes_first = [&](const timed_event &e) {
+            return e.time < time || (e.time == time && e.event < event);
+        };
+        auto i = count++;
+        for (; i > 0 && comes_first(pending[i - 1]); i--) { pending[i] = pending[i - 1]; }
+        pending[i] = {event, time};
+        added = true;
+    };
+    add(sun_event::noon, times.noon);
+    add(sun_event::midnight, times.midnight);
+    for (auto e = static_cast<std::size_t>(sun_event::astro_dawn); e < sun_event_count; e++) {
+        const auto event = static_cast<sun_event>(e);
+        if (const auto &time = times.*detail::member_of(event)) add(event, *time);
+    }
+    idle_days = added ? 0 : idle_days + 1;
+
+    // The next day's events are no more than 12 hours before its noon, which is less than a minute off a day after
+    // this one. Ten minutes leave room for the second pass of the calculation moving the events a bit further out.
+    bound = times.noon + std::chrono::hours(12) - std::chrono::minutes(10);
+    next_date += date::days(1);
+}
+
+// The order of an event_schedule
+static bool comes_before(const sun::noaa::site_event &lhs, const sun::noaa::site_event &rhs) {
+    if (lhs.time != rhs.time) return lhs.time < rhs.time;
+    if (lhs.site != rhs.site) return lhs.site < rhs.site;
+    return lhs.event < rhs.event;
+}
+
+sun::noaa::event_schedule::event_schedule(const location *locations, std::size_t count, sys_seconds from,
+                                          sun_event_mask events) {
+    streams.reserve(count);
+    heap.reserve(count);
+    for (std::size_t i = 0; i < count; i++) {
+        streams.emplace_back(locations[i].latitude, locations[i].longitude, from, events);
+        if (const auto next = streams.back().next()) heap.push_back({i, next->event, next->time});
+    }
+    std::make_heap(heap.begin(), heap.end(), [](const auto &lhs, const auto &rhs) { return comes_before(rhs, lhs); });
+}
+
+auto sun::noaa::event_schedule::peek() const -> optional<site_event> {
+    if (heap.empty()) return std::nullopt;
+    return heap.front();
+}
+
+auto sun::noaa::event_schedule::pop() -> optional<site_event> {
+    if (heap.empty()) return std::nullopt;
+    const auto res = heap.front();
+    advance();
+    return res;
+}
+
+auto sun::noaa::event_schedule::pop_until(sys_seconds until, std::vector<site_event> &out) -> std::size_t {
+    std::size_t n = 0;
+    for (; !heap.empty() && heap.front().time < until; n++) {
+        out.push_back(heap.front());
+        advance();
+    }
+    return n;
+}
+
+void sun::noaa::event_schedule::advance() {
+    // The location of the first event moves down the heap with its next one, which takes half the comparisons of
+    // popping it and pushing that back
+    auto next = streams[heap.front().site].next();
+    if (!next) {
+        heap.front() = heap.back();
+        heap.pop_back();
+        if (heap.empty()) return;
+    }
+    const auto item = next ? site_event{heap.front().site, next->event, next->time} : heap.front();
+    const auto size = heap.size();
+    std::size_t i = 0;
+    for (std::size_t child = 1; child < size; child = 2 * i + 1) {
+        if (child + 1 < size && comes_before(heap[child + 1], heap[child])) child++;
+        if (!comes_before(heap[child], item)) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = item;
+}
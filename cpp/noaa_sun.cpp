@@ -2,9 +2,15 @@
 // SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
 
 #include "angle.h"
+#include "instrumentation.h"
 #include "julian_date.h"
+#include "noaa_terms.h"
 #include "rust_sun_ffi.h"
 #include "sun.h"
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+#include <utility>
 
 using date::sys_days;
 using date::sys_seconds;
@@ -58,6 +64,7 @@ Angle obliquity_correction(julian_century tp) {
 }
 
 Angle sun_declination(julian_century tp) {
+    SUN_COUNT(noaa_sun_declination);
     auto al = sun_apparent_longitude(tp);
     auto oc = obliquity_correction(tp);
 
@@ -65,6 +72,7 @@ Angle sun_declination(julian_century tp) {
 }
 
 Angle equation_of_time(julian_century tp) {
+    SUN_COUNT(noaa_equation_of_time);
     auto oc = obliquity_correction(tp);
     auto I2 = sun_geometric_mean_longitude(tp);
     auto J2 = sun_geometric_mean_anomaly(tp);
@@ -76,14 +84,33 @@ Angle equation_of_time(julian_century tp) {
     return Angle::from_rad(V2);
 }
 
-Angle hour_angle(julian_century tp, Angle latitude, Angle elevation) {
+template<class Terms>
+Angle hour_angle(const Terms &terms, julian_century tp, Angle latitude, Angle elevation) {
     // The original JavaScript code just comments to negate the return value for sunset, which is ugly, so we use
     // copysign() and negated elevation inputs to do that. Inspired by redshift/solar.c.
-    auto decli = sun_declination(tp);
-    auto omega = acos(cos(elevation) / (cos(latitude) * cos(decli)) - tan(latitude) * tan(decli));
+    using trig = typename trig_of<Terms>::type;
+    auto decli = terms.sun_declination(tp);
+    auto omega = trig::acos(trig::cos(elevation) / (trig::cos(latitude) * trig::cos(decli)) -
+                            trig::tan(latitude) * trig::tan(decli));
     return Angle::from_rad(copysign(omega, elevation.rad()));
 }
 
+// hour_angle for one of the predefined events. The cosine and sign of the elevation are known at compile time here.
+template<sun::sun_event Event, class Terms>
+Angle hour_angle(const Terms &terms, julian_century tp, Angle latitude) {
+    constexpr auto elevation = sun::elevation_of(Event);
+    constexpr auto cos_elevation = sun::sun_event_trig[static_cast<std::size_t>(Event)].cos;
+    using trig = typename trig_of<Terms>::type;
+    auto decli = terms.sun_declination(tp);
+    auto omega = trig::acos(cos_elevation / (trig::cos(latitude) * trig::cos(decli)) -
+                            trig::tan(latitude) * trig::tan(decli));
+    if constexpr (elevation.rad() < 0) {
+        return Angle::from_rad(-omega);
+    } else {
+        return Angle::from_rad(omega);
+    }
+}
+
 Angle elevation_from_hour_angle(julian_century tp, Angle latitude, Angle hour_angle) {
     auto decli = sun_declination(tp);
     auto elev = acos(cos(hour_angle) * cos(latitude) * cos(decli) + sin(latitude) * sin(decli));
@@ -92,42 +119,178 @@ Angle elevation_from_hour_angle(julian_century tp, Angle latitude, Angle hour_an
 
 static constexpr auto Noon = Angle::from_deg(180);
 
-julian_days time_of_solar_noon(julian_century day, Angle longitude) {
+template<class Terms>
+julian_days time_of_solar_noon(const Terms &terms, julian_century day, Angle longitude) {
     // First, we approximate the time of local noon via the longitude...
     const auto approx_noon_offset = julian_days{Noon - longitude};
     auto tp = day + approx_noon_offset;
 
     // ...and calculate the equation of time for that
-    auto eq_of_time = equation_of_time(tp);
+    auto eq_of_time = terms.equation_of_time(tp);
     tp = day + julian_days{Noon - longitude - eq_of_time};
 
     // with the new time point, we do a second pass to get the exact result
-    eq_of_time = equation_of_time(tp);
+    eq_of_time = terms.equation_of_time(tp);
     return julian_days{Noon - longitude - eq_of_time};
 }
 
-julian_days time_of_solar_elevation(julian_century noon, Angle latitude, Angle longitude, Angle elevation) {
+// time_of_solar_noon with the exact terms, through the noon memo if one is installed
+static julian_days exact_solar_noon(julian_century day, sys_days date, Angle longitude) {
+    auto *memo = active_noon_memo();
+    if (!memo) return time_of_solar_noon(exact_terms{}, day, longitude);
+    if (auto noon = memo->find(date, longitude)) return julian_days(*noon);
+
+    auto noon = time_of_solar_noon(exact_terms{}, day, longitude);
+    memo->insert(date, longitude, noon.count());
+    return noon;
+}
+
+template<class Terms>
+julian_days time_of_solar_elevation(const Terms &terms, julian_century noon, Angle latitude, Angle longitude,
+                                    Angle elevation) {
     // We can reuse the computation of actual noon and apply the hour angle from there like the sheet does.
-    auto angle = hour_angle(noon, latitude, elevation);
+    auto angle = hour_angle(terms, noon, latitude, elevation);
     auto tp = noon + julian_days{angle};
 
     // Then, with the new time point, we do a second pass to get exact equation of time and hour angle and return
     // the angle as julian days from midnight like we do for noon.
-    auto eq_of_time = equation_of_time(tp);
-    angle = hour_angle(tp, latitude, elevation);
+    auto eq_of_time = terms.equation_of_time(tp);
+    angle = hour_angle(terms, tp, latitude, elevation);
     return julian_days{Noon - longitude - eq_of_time + angle};
 }
 
-Angle sun::noaa::get_sun_elevation(Angle latitude, Angle longitude, date::sys_seconds time_point) {
+// Single pass variants of the above, for when there is a good guess for the result already, like the same event on
+// the day before. The guess is in days from midnight, like the results.
+template<class Terms>
+julian_days time_of_solar_noon(const Terms &terms, julian_century day, Angle longitude, julian_days guess) {
+    auto eq_of_time = terms.equation_of_time(day + guess);
+    return julian_days{Noon - longitude - eq_of_time};
+}
+
+template<class Terms>
+julian_days time_of_solar_elevation(const Terms &terms, julian_century day, Angle latitude, Angle longitude,
+                                    Angle elevation, julian_days guess) {
+    auto tp = day + guess;
+    auto eq_of_time = terms.equation_of_time(tp);
+    auto angle = hour_angle(terms, tp, latitude, elevation);
+    return julian_days{Noon - longitude - eq_of_time + angle};
+}
+
+// time_of_solar_elevation for one of the predefined events
+template<sun::sun_event Event, class Terms>
+julian_days time_of_solar_elevation(const Terms &terms, julian_century noon, Angle latitude, Angle longitude) {
+    auto angle = hour_angle<Event>(terms, noon, latitude);
+    auto tp = noon + julian_days{angle};
+
+    auto eq_of_time = terms.equation_of_time(tp);
+    angle = hour_angle<Event>(terms, tp, latitude);
+    return julian_days{Noon - longitude - eq_of_time + angle};
+}
+
+// The time of an event on the night or day of j_noon, starting from date's midnight
+template<sun::sun_event Event, class Terms>
+static auto event_time(const Terms &terms, julian_century j_noon, Angle lat, Angle lon, sys_days date)
+        -> optional<sys_seconds> {
+    auto angle = time_of_solar_elevation<Event>(terms, j_noon, lat, lon);
+    if (!std::isnan(angle.count())) {
+        return floor<seconds>(date + angle);
+    } else {
+        SUN_COUNT(noaa_missing_events);
+        return std::nullopt;
+    }
+}
+
+static julian_century julian_century_of(sys_seconds time_point) {
     constexpr auto start_of_julian_century = julian_days{2451545.0};
-    const auto j_tp = julian_day(julian_date::sys_to_julian(time_point)) - start_of_julian_century;
+    return julian_day(julian_date::sys_to_julian(time_point)) - start_of_julian_century;
+}
 
+// The hour angle of the sun at a longitude and time, which is j_tp in julian centuries
+static Angle hour_angle_at(julian_century j_tp, Angle longitude, sys_seconds time_point) {
     auto date = floor<date::days>(time_point);
     auto minutes_from_midnight = Angle(julian_days(time_point - date));
     auto eq_of_time = equation_of_time(j_tp);
+    return longitude + eq_of_time + minutes_from_midnight - Noon;
+}
+
+// The azimuth of a direction from its east and north components, clockwise from north in [0, 2 pi)
+static Angle azimuth_of(double east, double north) {
+    const auto azimuth = atan2(east, north);
+    return Angle::from_rad(azimuth < 0 ? azimuth + 2 * M_PI : azimuth);
+}
+
+Angle sun::noaa::get_sun_elevation(Angle latitude, Angle longitude, date::sys_seconds time_point) {
+    const auto j_tp = julian_century_of(time_point);
+    return elevation_from_hour_angle(j_tp, latitude, hour_angle_at(j_tp, longitude, time_point));
+}
+
+auto sun::noaa::get_sun_position(Angle latitude, Angle longitude, date::sys_seconds time_point) -> sun_position {
+    const auto j_tp = julian_century_of(time_point);
+    const auto angle = hour_angle_at(j_tp, longitude, time_point);
+    const auto decli = sun_declination(j_tp);
+
+    // Same as elevation_from_hour_angle, and the horizontal components of the direction of the sun for the azimuth
+    const auto elev = acos(cos(angle) * cos(latitude) * cos(decli) + sin(latitude) * sin(decli));
+    const auto east = -cos(decli) * sin(angle);
+    const auto north = sin(decli) * cos(latitude) - cos(decli) * cos(angle) * sin(latitude);
+    return {Angle::from_rad(elev), azimuth_of(east, north)};
+}
+
+void sun::noaa::get_sun_positions(Angle latitude, Angle longitude, const date::sys_seconds *time_points,
+                                  std::size_t count, const sun_positions_soa &out) {
+    for (std::size_t first = 0, last; first < count; first = last) {
+        const auto day = floor<date::days>(time_points[first]);
+        for (last = first + 1; last < count && floor<date::days>(time_points[last]) == day; last++) {}
+        elevation_sampler(latitude, longitude, day)
+                .fill(time_points + first, last - first, {out.elevation + first, out.azimuth + first});
+    }
+}
+
+sun::noaa::elevation_sampler::elevation_sampler(Angle latitude, Angle longitude, date::sys_days date)
+    : midnight(static_cast<double>(date.time_since_epoch().count())), longitude(longitude.rad()),
+      sin_lat(sin(latitude)), cos_lat(cos(latitude)) {
+    constexpr auto start_of_julian_century = julian_days{2451545.0};
+    const auto j_day = julian_day(julian_date::sys_to_julian(sys_seconds(date))) - start_of_julian_century;
+
+    // Fit the quadratics through midnight, noon and the next midnight UTC. Both terms change slowly enough that this
+    // is off by less than 1e-7 rad over the day.
+    double eot[3], sd[3], cd[3];
+    for (int i = 0; i < 3; i++) {
+        const auto tp = j_day + julian_days(0.5 * i);
+        const auto decl = ::sun_declination(tp);
+        eot[i] = ::equation_of_time(tp).rad();
+        sd[i] = sin(decl);
+        cd[i] = cos(decl);
+    }
+    auto fit = [](double *c, const double *f) {
+        c[0] = f[0];
+        c[1] = -3 * f[0] + 4 * f[1] - f[2];
+        c[2] = 2 * f[0] - 4 * f[1] + 2 * f[2];
+    };
+    fit(eq_of_time, eot);
+    fit(sin_decl, sd);
+    fit(cos_decl, cd);
+}
+
+auto sun::noaa::elevation_sampler::elevation(date::sys_seconds time_point) const -> Angle {
+    const auto x = static_cast<double>(time_point.time_since_epoch().count()) / 86400.0 - midnight;
+    auto quadratic = [x](const double *c) { return c[0] + x * (c[1] + x * c[2]); };
 
-    auto angle = longitude + eq_of_time + minutes_from_midnight - Noon;
-    return elevation_from_hour_angle(j_tp, latitude, angle);
+    const auto hour_angle = longitude + quadratic(eq_of_time) + 2 * M_PI * x - M_PI;
+    const auto c = cos(hour_angle) * cos_lat * quadratic(cos_decl) + sin_lat * quadratic(sin_decl);
+    return Angle::from_rad(acos(std::clamp(c, -1.0, 1.0)));
+}
+
+auto sun::noaa::elevation_sampler::position(date::sys_seconds time_point) const -> sun_position {
+    const auto x = static_cast<double>(time_point.time_since_epoch().count()) / 86400.0 - midnight;
+    auto quadratic = [x](const double *c) { return c[0] + x * (c[1] + x * c[2]); };
+
+    const auto hour_angle = longitude + quadratic(eq_of_time) + 2 * M_PI * x - M_PI;
+    const auto sd = quadratic(sin_decl), cd = quadratic(cos_decl);
+    const auto c = cos(hour_angle) * cos_lat * cd + sin_lat * sd;
+    const auto east = -cd * sin(hour_angle);
+    const auto north = sd * cos_lat - cd * cos(hour_angle) * sin_lat;
+    return {Angle::from_rad(acos(std::clamp(c, -1.0, 1.0))), azimuth_of(east, north)};
 }
 
 optional<sys_seconds> sun::noaa::get_sun_time(Angle latitude, Angle longitude, sys_days date, Angle elevation) {
@@ -135,8 +298,9 @@ optional<sys_seconds> sun::noaa::get_sun_time(Angle latitude, Angle longitude, s
     // hour angles we will calculate. We have to cast to seconds first to keep the midnight part.
     constexpr auto start_of_julian_century = julian_days{2451545.0};
     const auto j_day = julian_day(julian_date::sys_to_julian(sys_seconds(date))) - start_of_julian_century;
+    SUN_COUNT(noaa_sun_time);
 
-    auto a_noon = time_of_solar_noon(j_day, longitude);
+    auto a_noon = exact_solar_noon(j_day, date, longitude);
     auto j_noon = j_day + a_noon;
     auto t_noon = date + a_noon;
 
@@ -144,74 +308,403 @@ optional<sys_seconds> sun::noaa::get_sun_time(Angle latitude, Angle longitude, s
         return floor<seconds>(t_noon);
     } else if (elevation == SunTime::Midnight) {
         return floor<seconds>(t_noon + julian_days(0.5));
-    } else if (auto angle = time_of_solar_elevation(j_noon, latitude, longitude, elevation);
+    } else if (auto angle = time_of_solar_elevation(exact_terms{}, j_noon, latitude, longitude, elevation);
                !std::isnan(angle.count())) {
         return floor<seconds>(date + angle);
     } else {
+        SUN_COUNT(noaa_missing_events);
+        return std::nullopt;
+    }
+}
+
+// The sun is closest to the zenith at noon, |latitude - declination| away, and furthest at midnight, 180° - |latitude
+// + declination|. So it passes a zenith angle on a day exactly if the declination is within these bounds, in degrees.
+static auto declination_bounds(double latitude, double zenith) -> std::pair<double, double> {
+    return {std::max(latitude - zenith, zenith - 180.0 - latitude),
+            std::min(latitude + zenith, 180.0 - zenith - latitude)};
+}
+
+// Below this latitude, every event happens on every day: even astronomical twilight only needs a declination within
+// 180° - 108° - 48° = 24° of the equator, and the sun never gets further than 23.45° from it.
+static constexpr auto polar_latitude = 48.0;
+
+// Returns the events whose elevation the sun can't reach on a day at latitude, if its declination at noon is between
+// low and high, in degrees. Their first pass is NaN already, so the calculation would have dropped them as well.
+static auto impossible_events(double latitude, double low, double high) -> sun::sun_event_mask {
+    using sun::sun_event;
+    sun::sun_event_mask res = 0;
+    for (auto event: {sun_event::astro_dawn, sun_event::naut_dawn, sun_event::civil_dawn, sun_event::sunrise,
+                      sun_event::sunset, sun_event::civil_dusk, sun_event::naut_dusk, sun_event::astro_dusk}) {
+        const auto [min, max] = declination_bounds(latitude, std::abs(sun::elevation_of(event).deg()));
+        if (high < min || low > max) res |= sun::mask_of(event);
+    }
+    return res;
+}
+
+// Returns the lowest and highest declination of the sun at the noon of any longitude from -180° to 180° on the day
+// starting at j_day, in degrees. That noon is up to 0.012 days outside of the day with the equation of time. The ends
+// and the middle are sampled, and the margin covers the curvature in between (3e-4° around the solstices) as well as
+// the differences between the terms, so this rather says too much.
+template<class Terms>
+static auto noon_declinations(const Terms &terms, julian_century j_day) -> std::pair<double, double> {
+    constexpr auto margin = 0.01;
+    const auto a = terms.sun_declination(j_day - julian_days(0.05)).deg();
+    const auto b = terms.sun_declination(j_day + julian_days(0.5)).deg();
+    const auto c = terms.sun_declination(j_day + julian_days(1.05)).deg();
+    return {std::min({a, b, c}) - margin, std::max({a, b, c}) + margin};
+}
+
+// Finds the impossible events of each location in a batch. The declinations of the date are only calculated for the
+// first location that needs them, as most batches never get close to the poles.
+namespace {
+    template<class Terms>
+    struct polar_filter {
+        const Terms &terms;
+        julian_century j_day;
+        optional<std::pair<double, double>> declinations;
+
+        auto operator()(Angle latitude, Angle longitude) -> sun::sun_event_mask {
+            if (std::abs(latitude.deg()) < polar_latitude || std::abs(longitude.deg()) > 180.0) return 0;
+            if (!declinations) declinations = noon_declinations(terms, j_day);
+            return impossible_events(latitude.deg(), declinations->first, declinations->second);
+        }
+    };
+}// namespace
+
+sun::noaa::polar_table::polar_table(sys_days first_day, sys_days last_day) : first(first_day) {
+    constexpr auto start_of_julian_century = julian_days{2451545.0};
+    for (auto date = first_day; date <= last_day; date += date::days(1)) {
+        const auto j_day = julian_day(julian_date::sys_to_julian(sys_seconds(date))) - start_of_julian_century;
+        declinations.push_back(noon_declinations(exact_terms{}, j_day));
+    }
+}
+
+auto sun::noaa::polar_table::impossible(Angle latitude, sys_days date) const -> sun_event_mask {
+    const auto day = (date - first).count();
+    if (day < 0 || static_cast<std::size_t>(day) >= declinations.size()) return 0;
+    if (std::abs(latitude.deg()) < polar_latitude) return 0;
+    const auto [low, high] = declinations[static_cast<std::size_t>(day)];
+    return impossible_events(latitude.deg(), low, high);
+}
+
+// Days from tp until the apparent longitude of the sun is next at lambda degrees. It moves by about 1° a day, so the
+// mean motion is a good first guess and a few Newton steps on the actual longitude take care of the rest.
+static auto days_until_longitude(julian_century tp, double lambda) -> double {
+    constexpr auto degrees_per_day = 360.0 / 365.2422;
+    auto remaining = [&](double days) {
+        return std::remainder(lambda - sun_apparent_longitude(tp + julian_days(days)).deg(), 360.0);
+    };
+    auto days = remaining(0) / degrees_per_day;
+    if (days < 0) days += 365.2422;
+    for (int i = 0; i < 3; i++) { days += remaining(days) / degrees_per_day; }
+    return days;
+}
+
+optional<sys_seconds> sun::noaa::next_crossing(Angle latitude, Angle longitude, sys_seconds from, Angle elevation) {
+    // Tries some days in a row. Far from the prime meridian, the event of a date can be on the UTC day before or
+    // after, so we always start a day early.
+    auto try_days = [&](sys_days first, int count) -> optional<sys_seconds> {
+        for (auto date = first; date < first + date::days(count); date += date::days(1)) {
+            if (auto tp = get_sun_time(latitude, longitude, date, elevation); tp && *tp >= from) return tp;
+        }
         return std::nullopt;
+    };
+
+    // Noon and midnight happen every day
+    const auto today = floor<date::days>(from);
+    if (elevation == SunTime::Noon || elevation == SunTime::Midnight) return try_days(today - date::days(1), 3);
+
+    // Other elevations are out of reach in polar days and nights. Those end when the declination enters the bounds of
+    // the elevation, which happens at fixed apparent longitudes of the sun, as sin(declination) = sin(obliquity) *
+    // sin(longitude), so we can jump right there. The bounds only hold exactly at noon or midnight, so we still try
+    // the days around that.
+    const auto [low, high] = declination_bounds(latitude.deg(), std::abs(elevation.deg()));
+    auto date = today - date::days(1);
+    for (int i = 0; i < 8; i++) {
+        constexpr auto start_of_julian_century = julian_days{2451545.0};
+        const auto j_day = julian_day(julian_date::sys_to_julian(sys_seconds(date))) - start_of_julian_century;
+        const auto obliquity = obliquity_correction(j_day).deg();
+        if (low > high || low > obliquity || high < -obliquity) return std::nullopt;
+
+        const auto declination = sun_declination(j_day).deg();
+        if (declination < low || declination > high) {
+            // The declination rises through the lower bound or falls through the upper one, whichever comes first
+            auto days = std::numeric_limits<double>::infinity();
+            auto longitude_of = [&](double decl) {
+                return asin(sin(Angle::from_deg(decl)) / sin(Angle::from_deg(obliquity))) * (180.0 / M_PI);
+            };
+            if (low > -obliquity) days = std::min(days, days_until_longitude(j_day, longitude_of(low)));
+            if (high < obliquity) days = std::min(days, days_until_longitude(j_day, 180.0 - longitude_of(high)));
+            if (std::isfinite(days)) date += date::days(std::max(0, static_cast<int>(std::floor(days)) - 1));
+        }
+        if (auto tp = try_days(date, 3)) return tp;
+        date += date::days(3);
     }
+    return std::nullopt;
 }
 
-auto sun::noaa::get_sun_times(Angle lat, Angle lon, date::sys_days date) -> sun_times {
+auto sun::noaa::get_sun_times(Angle lat, Angle lon, date::sys_days date, sun_event_mask events) -> sun_times {
+    events = (events & all_sun_events) | sun_event::noon | sun_event::midnight;
+    auto get = [&](sun_event event, Angle elevation) -> optional<sys_seconds> {
+        if (events & mask_of(event)) return get_sun_time(lat, lon, date, elevation);
+        else
+            return std::nullopt;
+    };
     return {
             get_sun_time(lat, lon, date, SunTime::Noon).value(),
             get_sun_time(lat, lon, date, SunTime::Midnight).value(),
-            get_sun_time(lat, lon, date, SunTime::AstroDawn),
-            get_sun_time(lat, lon, date, SunTime::NautDawn),
-            get_sun_time(lat, lon, date, SunTime::CivilDawn),
-            get_sun_time(lat, lon, date, SunTime::Sunrise),
-            get_sun_time(lat, lon, date, SunTime::Sunset),
-            get_sun_time(lat, lon, date, SunTime::CivilDusk),
-            get_sun_time(lat, lon, date, SunTime::NautDusk),
-            get_sun_time(lat, lon, date, SunTime::AstroDusk),
+            get(sun_event::astro_dawn, SunTime::AstroDawn),
+            get(sun_event::naut_dawn, SunTime::NautDawn),
+            get(sun_event::civil_dawn, SunTime::CivilDawn),
+            get(sun_event::sunrise, SunTime::Sunrise),
+            get(sun_event::sunset, SunTime::Sunset),
+            get(sun_event::civil_dusk, SunTime::CivilDusk),
+            get(sun_event::naut_dusk, SunTime::NautDusk),
+            get(sun_event::astro_dusk, SunTime::AstroDusk),
+            events,
     };
 }
 
-auto sun::noaa::get_sun_times_opt(Angle lat, Angle lon, date::sys_days date) -> sun_times {
+// Fills in one of the optional events of res, if it's in res.events. Impossible ones are left at nullopt right away.
+template<sun::sun_event Event, class Terms>
+static void set_event(sun::sun_times &res, const Terms &terms, julian_century j_noon, Angle lat, Angle lon,
+                      sys_days date, sun::sun_event_mask impossible) {
+    if (!res.has(Event)) return;
+    if (impossible & sun::mask_of(Event)) {
+        SUN_COUNT(noaa_missing_events);
+    } else {
+        res.*sun::noaa::detail::member_of(Event) = event_time<Event>(terms, j_noon, lat, lon, date);
+    }
+}
+
+template<class Terms>
+static auto sun_times_from_terms(const Terms &terms, Angle lat, Angle lon, sys_days date, julian_century j_day,
+                                 sun::sun_event_mask events = sun::all_sun_events, sun::sun_event_mask impossible = 0)
+        -> sun::sun_times {
+    sun::sun_times res{};
+    SUN_COUNT(noaa_sun_times);
+
+    julian_days a_noon;
+    if constexpr (std::is_same_v<Terms, exact_terms>) {
+        a_noon = exact_solar_noon(j_day, date, lon);
+    } else {
+        a_noon = time_of_solar_noon(terms, j_day, lon);
+    }
+    auto j_noon = j_day + a_noon;
+    auto t_noon = date + a_noon;
+
+    res.noon = floor<seconds>(t_noon);
+    res.midnight = floor<seconds>(t_noon + julian_days(0.5));
+
+    using sun::sun_event;
+    res.events = (events & sun::all_sun_events) | sun_event::noon | sun_event::midnight;
+    set_event<sun_event::astro_dawn>(res, terms, j_noon, lat, lon, date, impossible);
+    set_event<sun_event::naut_dawn>(res, terms, j_noon, lat, lon, date, impossible);
+    set_event<sun_event::civil_dawn>(res, terms, j_noon, lat, lon, date, impossible);
+    set_event<sun_event::sunrise>(res, terms, j_noon, lat, lon, date, impossible);
+    set_event<sun_event::sunset>(res, terms, j_noon, lat, lon, date, impossible);
+    set_event<sun_event::civil_dusk>(res, terms, j_noon, lat, lon, date, impossible);
+    set_event<sun_event::naut_dusk>(res, terms, j_noon, lat, lon, date, impossible);
+    set_event<sun_event::astro_dusk>(res, terms, j_noon, lat, lon, date, impossible);
+
+    return res;
+}
+
+auto sun::noaa::get_sun_times_opt(Angle lat, Angle lon, date::sys_days date, sun_event_mask events) -> sun_times {
     // The requested midnight UTC time point in julian days. This is the mathematical baseline for all the
     // hour angles we will calculate. We have to cast to seconds first to keep the midnight part.
     constexpr auto start_of_julian_century = julian_days{2451545.0};
     const auto j_day = julian_day(julian_date::sys_to_julian(sys_seconds(date))) - start_of_julian_century;
 
-    sun_times res{};
+    return sun_times_from_terms(exact_terms{}, lat, lon, date, j_day, events);
+}
 
-    auto a_noon = time_of_solar_noon(j_day, lon);
-    auto j_noon = j_day + a_noon;
+template<trig_precision P>
+auto sun::noaa::get_sun_times_approx(Angle lat, Angle lon, date::sys_days date, sun_event_mask events) -> sun_times {
+    constexpr auto start_of_julian_century = julian_days{2451545.0};
+    const auto j_day = julian_day(julian_date::sys_to_julian(sys_seconds(date))) - start_of_julian_century;
+
+    return sun_times_from_terms(approx_terms<P>{}, lat, lon, date, j_day, events);
+}
+
+template sun::sun_times sun::noaa::get_sun_times_approx<trig_precision::low>(Angle, Angle, sys_days,
+                                                                              sun_event_mask);
+template sun::sun_times sun::noaa::get_sun_times_approx<trig_precision::medium>(Angle, Angle, sys_days,
+                                                                                 sun_event_mask);
+template sun::sun_times sun::noaa::get_sun_times_approx<trig_precision::high>(Angle, Angle, sys_days,
+                                                                               sun_event_mask);
+
+void sun::noaa::get_sun_times_batch(const location *locations, std::size_t count, date::sys_days date,
+                                    sun_times *out, sun_event_mask events) {
+    constexpr auto start_of_julian_century = julian_days{2451545.0};
+    const auto j_day = julian_day(julian_date::sys_to_julian(sys_seconds(date))) - start_of_julian_century;
+    const auto terms = date_terms(j_day);
+    auto polar = polar_filter<date_terms>{terms, j_day, std::nullopt};
+
+    for (std::size_t i = 0; i < count; i++) {
+        const auto &l = locations[i];
+        const auto impossible = polar(l.latitude, l.longitude);
+        out[i] = sun_times_from_terms(terms, l.latitude, l.longitude, date, j_day, events, impossible);
+    }
+}
+
+auto sun::noaa::detail::event_base_of(Angle lat, Angle lon, date::sys_days date, sun_times &out) -> event_base {
+    constexpr auto start_of_julian_century = julian_days{2451545.0};
+    const auto j_day = julian_day(julian_date::sys_to_julian(sys_seconds(date))) - start_of_julian_century;
+    SUN_COUNT(noaa_sun_times);
+
+    auto a_noon = exact_solar_noon(j_day, date, lon);
     auto t_noon = date + a_noon;
+    out.noon = floor<seconds>(t_noon);
+    out.midnight = floor<seconds>(t_noon + julian_days(0.5));
 
-    res.noon = floor<seconds>(t_noon);
-    res.midnight = floor<seconds>(t_noon + julian_days(0.5));
+    return {date, j_day + a_noon, lat, lon};
+}
 
-    auto get_time = [&](Angle elevation) -> optional<sys_seconds> {
-        auto angle = time_of_solar_elevation(j_noon, lat, lon, elevation);
-        if (!std::isnan(angle.count())) {
-            return floor<seconds>(date + angle);
-        } else {
-            return std::nullopt;
-        }
+template<sun::sun_event Event>
+auto sun::noaa::detail::event_time(const event_base &base) -> optional<sys_seconds> {
+    return ::event_time<Event>(exact_terms{}, base.noon, base.latitude, base.longitude, base.date);
+}
+
+template optional<sys_seconds> sun::noaa::detail::event_time<sun::sun_event::astro_dawn>(const event_base &);
+template optional<sys_seconds> sun::noaa::detail::event_time<sun::sun_event::naut_dawn>(const event_base &);
+template optional<sys_seconds> sun::noaa::detail::event_time<sun::sun_event::civil_dawn>(const event_base &);
+template optional<sys_seconds> sun::noaa::detail::event_time<sun::sun_event::sunrise>(const event_base &);
+template optional<sys_seconds> sun::noaa::detail::event_time<sun::sun_event::sunset>(const event_base &);
+template optional<sys_seconds> sun::noaa::detail::event_time<sun::sun_event::civil_dusk>(const event_base &);
+template optional<sys_seconds> sun::noaa::detail::event_time<sun::sun_event::naut_dusk>(const event_base &);
+template optional<sys_seconds> sun::noaa::detail::event_time<sun::sun_event::astro_dusk>(const event_base &);
+
+auto sun::noaa::get_sun_times_opt(Angle lat, Angle lon, date::sys_days date, const daily_ephemeris &ephemeris)
+        -> sun_times {
+    constexpr auto start_of_julian_century = julian_days{2451545.0};
+    const auto j_day = julian_day(julian_date::sys_to_julian(sys_seconds(date))) - start_of_julian_century;
+
+    return sun_times_from_terms(ephemeris, lat, lon, date, j_day);
+}
+
+void sun::noaa::get_sun_times_batch(const location *locations, std::size_t count, date::sys_days date,
+                                    sun_times *out, const daily_ephemeris &ephemeris) {
+    constexpr auto start_of_julian_century = julian_days{2451545.0};
+    const auto j_day = julian_day(julian_date::sys_to_julian(sys_seconds(date))) - start_of_julian_century;
+    auto polar = polar_filter<daily_ephemeris>{ephemeris, j_day, std::nullopt};
+
+    for (std::size_t i = 0; i < count; i++) {
+        const auto &l = locations[i];
+        out[i] = sun_times_from_terms(ephemeris, l.latitude, l.longitude, date, j_day, all_sun_events,
+                                      polar(l.latitude, l.longitude));
+    }
+}
+
+void sun::noaa::get_sun_times_batch(const location *locations, sun_times_table &table, std::size_t day) {
+    constexpr auto start_of_julian_century = julian_days{2451545.0};
+    const auto date = table.date_of(day);
+    const auto j_day = julian_day(julian_date::sys_to_julian(sys_seconds(date))) - start_of_julian_century;
+    const auto terms = date_terms(j_day);
+    const auto events = all_sun_events;
+    auto polar = polar_filter<date_terms>{terms, j_day, std::nullopt};
+
+    for (std::size_t i = 0; i < table.locations(); i++) {
+        const auto &l = locations[i];
+        const auto impossible = polar(l.latitude, l.longitude);
+        table.set(i, day, sun_times_from_terms(terms, l.latitude, l.longitude, date, j_day, events, impossible));
+    }
+}
+
+// get_sun_times_range, with impossible events from polar if there is one
+static void sun_times_range(Angle lat, Angle lon, sys_days first_day, std::size_t days, sun::sun_times *out,
+                            const sun::noaa::polar_table *polar) {
+    using sun::sun_times;
+    namespace SunTime = sun::SunTime;
+    constexpr auto start_of_julian_century = julian_days{2451545.0};
+    // The error of a single pass grows with the square of how far an event moves per day. Up to four minutes, it stays
+    // well below a second. Events moving faster than that are the ones where the sun only just reaches an elevation.
+    constexpr auto max_warm_step = julian_days{4.0 / 1440.0};
+    static constexpr Angle elevations[] = {
+            SunTime::AstroDawn, SunTime::NautDawn,  SunTime::CivilDawn, SunTime::Sunrise,
+            SunTime::Sunset,    SunTime::CivilDusk, SunTime::NautDusk,  SunTime::AstroDusk,
     };
+    static constexpr optional<sys_seconds> sun_times::*members[] = {
+            &sun_times::astro_dawn, &sun_times::naut_dawn,  &sun_times::civil_dawn, &sun_times::sunrise,
+            &sun_times::sunset,     &sun_times::civil_dusk, &sun_times::naut_dusk,  &sun_times::astro_dusk,
+    };
+    const auto terms = exact_terms{};
+
+    // The results of the day before in days from midnight, NaN if there is none to start from, and how far they
+    // moved since the day before that. Extrapolating that step gives a guess that is good to a few seconds.
+    auto noon = julian_days{NAN};
+    julian_days events[8], steps[8];
+    std::fill(std::begin(events), std::end(events), julian_days{NAN});
+    std::fill(std::begin(steps), std::end(steps), julian_days{0.0});
+
+    for (std::size_t d = 0; d < days; d++) {
+        const auto date = first_day + date::days(d);
+        const auto j_day = julian_day(julian_date::sys_to_julian(sys_seconds(date))) - start_of_julian_century;
+
+        noon = d == 0 ? time_of_solar_noon(terms, j_day, lon) : time_of_solar_noon(terms, j_day, lon, noon);
+        const auto j_noon = j_day + noon;
+
+        auto &res = out[d];
+        res = {};
+        SUN_COUNT(noaa_sun_times);
+        res.noon = floor<seconds>(date + noon);
+        res.midnight = floor<seconds>(date + noon + julian_days(0.5));
+
+        // The warm pass starts from another time than noon, so it can't be skipped, but the full one can
+        const auto impossible = polar ? polar->impossible(lat, date) : 0;
+        for (std::size_t e = 0; e < std::size(elevations); e++) {
+            auto angle = julian_days{NAN};
+            if (!std::isnan(events[e].count())) {
+                auto guess = events[e] + steps[e];
+                angle = time_of_solar_elevation(terms, j_day, lat, lon, elevations[e], guess);
+                if (!(abs(angle - events[e]) < max_warm_step)) { angle = julian_days{NAN}; }
+            }
+            const auto event = static_cast<sun::sun_event>(static_cast<std::size_t>(sun::sun_event::astro_dawn) + e);
+            if (std::isnan(angle.count()) && !(impossible & sun::mask_of(event))) {
+                angle = time_of_solar_elevation(terms, j_noon, lat, lon, elevations[e]);
+            }
+
+            steps[e] = std::isnan(events[e].count()) ? julian_days{0.0} : angle - events[e];
+            events[e] = angle;
+            if (!std::isnan(angle.count())) {
+                res.*members[e] = floor<seconds>(date + angle);
+            } else {
+                SUN_COUNT(noaa_missing_events);
+            }
+        }
+    }
+}
 
-    res.astro_dawn = get_time(SunTime::AstroDawn);
-    res.naut_dawn = get_time(SunTime::NautDawn);
-    res.civil_dawn = get_time(SunTime::CivilDawn);
-    res.sunrise = get_time(SunTime::Sunrise);
-    res.sunset = get_time(SunTime::Sunset);
-    res.civil_dusk = get_time(SunTime::CivilDusk);
-    res.naut_dusk = get_time(SunTime::NautDusk);
-    res.astro_dusk = get_time(SunTime::AstroDusk);
+void sun::noaa::get_sun_times_range(Angle lat, Angle lon, date::sys_days first_day, std::size_t days, sun_times *out) {
+    if (days == 0 || std::abs(lat.deg()) < polar_latitude || std::abs(lon.deg()) > 180.0) {
+        return sun_times_range(lat, lon, first_day, days, out, nullptr);
+    }
+    const auto polar = polar_table(first_day, first_day + date::days(days - 1));
+    sun_times_range(lat, lon, first_day, days, out, &polar);
+}
 
-    return res;
+void sun::noaa::get_sun_times_range(Angle lat, Angle lon, date::sys_days first_day, std::size_t days, sun_times *out,
+                                    const polar_table &polar) {
+    sun_times_range(lat, lon, first_day, days, out, std::abs(lon.deg()) > 180.0 ? nullptr : &polar);
 }
 
-auto sun::get_sun_times_rust(Angle latitude, Angle longitude, date::sys_days date) -> sun_times {
+auto sun::get_sun_times_rust(Angle latitude, Angle longitude, date::sys_days date, sun_event_mask events)
+        -> sun_times {
     auto tp = sys_seconds(date).time_since_epoch().count();
-    auto res = get_sun_times_r(latitude.deg(), longitude.deg(), tp);
+    events = (events & all_sun_events) | sun_event::noon | sun_event::midnight;
+    SUN_COUNT(rust_sun_times);
+    sun_times_r res;
+    {
+        SUN_TIME(rust_call_ns);
+        res = get_sun_times_mask_r(latitude.deg(), longitude.deg(), tp, events);
+    }
+    SUN_TIME(rust_convert_ns);
     auto map = [](int64_t tp) -> optional<sys_seconds> {
         if (tp) return sys_seconds(seconds(tp));
         else
             return std::nullopt;
     };
-    return {
+    sun_times times = {
             sys_seconds(seconds(res.noon)),
             sys_seconds(seconds(res.midnight)),
             map(res.astro_dawn),
@@ -222,5 +715,8 @@ auto sun::get_sun_times_rust(Angle latitude, Angle longitude, date::sys_days dat
             map(res.civil_dusk),
             map(res.naut_dusk),
             map(res.astro_dusk),
+            events,
     };
+    SUN_COUNT_MISSING(rust_missing_events, times);
+    return times;
 }
@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
+
+// Internal header shared by the NOAA implementation files. Not part of the public API in sun.h.
+
+#ifndef SOLAR_CALCULATIONS_NOAA_TERMS_H
+#define SOLAR_CALCULATIONS_NOAA_TERMS_H
+
+#include "angle.h"
+#include "angle_approx.h"
+#include "instrumentation.h"
+#include "julian_date.h"
+#include <type_traits>
+
+// Cells of the NOAA sheet, implemented in noaa_sun.cpp. All take julian centuries since J2000.0.
+Angle sun_geometric_mean_longitude(julian_date::julian_century tp);
+Angle sun_geometric_mean_anomaly(julian_date::julian_century tp);
+double earth_orbit_eccentricity(julian_date::julian_century tp);
+Angle mean_ecliptic_obliquity(julian_date::julian_century tp);
+Angle obliquity_correction(julian_date::julian_century tp);
+Angle sun_declination(julian_date::julian_century tp);
+Angle equation_of_time(julian_date::julian_century tp);
+
+namespace sun::noaa {
+    struct noon_memo;
+}
+
+// The memo installed with sun::noaa::use_noon_memo, or nullptr, implemented in noaa_memo.cpp.
+sun::noaa::noon_memo *active_noon_memo();
+
+// The sheet evaluates every date dependent term from scratch for each time point. This provider does exactly that and
+// is what the single-location functions use.
+struct exact_terms {
+    Angle equation_of_time(julian_date::julian_century tp) const { return ::equation_of_time(tp); }
+    Angle sun_declination(julian_date::julian_century tp) const { return ::sun_declination(tp); }
+};
+
+// The trigonometry of the templates in noaa_sun.cpp with a terms provider: libm, unless the provider brings its own
+// as Terms::trig, like approx_terms.
+struct libm_trig {
+    static double sin(Angle a) { return ::sin(a); }
+    static double cos(Angle a) { return ::cos(a); }
+    static double tan(Angle a) { return ::tan(a); }
+    static double acos(double x) { return std::acos(x); }
+};
+
+template<trig_precision P>
+struct approx_trig {
+    static double sin(Angle a) { return approx::sin<P>(a); }
+    static double cos(Angle a) { return approx::cos<P>(a); }
+    static double tan(Angle a) { return approx::tan<P>(a); }
+    static double acos(double x) { return approx::acos<P>(x); }
+};
+
+template<class Terms, class = void>
+struct trig_of {
+    using type = libm_trig;
+};
+
+template<class Terms>
+struct trig_of<Terms, std::void_t<typename Terms::trig>> {
+    using type = typename Terms::trig;
+};
+
+// exact_terms with the polynomials of angle_approx.h at precision P instead of libm, for get_sun_times_approx. That
+// includes the asin() that turns the sine of the declination into an angle, once per declination, which hour_angle
+// then takes trig::cos() and trig::tan() of.
+template<trig_precision P>
+struct approx_terms {
+    using trig = approx_trig<P>;
+
+    Angle equation_of_time(julian_date::julian_century tp) const {
+        SUN_COUNT(noaa_equation_of_time);
+        auto oc = obliquity(tp);
+        auto I2 = sun_geometric_mean_longitude(tp);
+        auto J2 = sun_geometric_mean_anomaly(tp);
+        auto K2 = earth_orbit_eccentricity(tp);
+        auto y = trig::tan(oc / 2) * trig::tan(oc / 2);
+
+        auto V2 = y * trig::sin(2 * I2) - 2 * K2 * trig::sin(J2) + 4 * K2 * y * trig::sin(J2) * trig::cos(2 * I2) -
+                  0.5 * y * y * trig::sin(4 * I2) - 1.25 * K2 * K2 * trig::sin(2 * J2);
+        return Angle::from_rad(V2);
+    }
+
+    Angle sun_declination(julian_date::julian_century tp) const {
+        SUN_COUNT(noaa_sun_declination);
+        auto t = tp.time_since_epoch().count();
+        auto an = sun_geometric_mean_anomaly(tp);
+        auto center = Angle::from_deg(trig::sin(an) * (1.914602 - t * (0.004817 + 0.000014 * t)) +
+                                      trig::sin(2 * an) * (0.019993 - 0.000101 * t) + trig::sin(3 * an) * 0.000289);
+        auto omega = Angle::from_deg(125.04 - 1934.136 * t);
+        auto al = sun_geometric_mean_longitude(tp) + center - Angle::from_deg(0.00569 + 0.00478 * trig::sin(omega));
+        return Angle::from_rad(approx::asin<P>(trig::sin(obliquity(tp)) * trig::sin(al)));
+    }
+
+    static Angle obliquity(julian_date::julian_century tp) {
+        auto t = tp.time_since_epoch().count();
+        auto a = Angle::from_deg(125.04 - 1934.136 * t);
+        return mean_ecliptic_obliquity(tp) + Angle::from_deg(0.00256 * trig::cos(a));
+    }
+};
+
+// For many locations on the same date, only the mean longitude and the mean anomaly change fast enough to matter
+// between the time points we evaluate. Both are polynomials in t, so we expand them exactly around the middle of the
+// day. Eccentricity, obliquity and the nutation terms change by less than 1e-8 over a day and are taken as constant.
+struct date_terms {
+    explicit date_terms(julian_date::julian_century day) : t0(day + julian_date::julian_days(0.5)) {
+        auto t = t0.time_since_epoch().count();
+        mean_lon = fmod(280.46646 + t * (36000.76983 + t * 0.0003032), 360.0);
+        mean_anom = 357.52911 + t * (35999.05029 - 0.0001537 * t);
+        ecc = earth_orbit_eccentricity(t0);
+        center1 = 1.914602 - t * (0.004817 + 0.000014 * t);
+        center2 = 0.019993 - 0.000101 * t;
+        aberration = 0.00569 + 0.00478 * sin(Angle::from_deg(125.04 - 1934.136 * t));
+        auto oc = obliquity_correction(t0);
+        sin_oc = sin(oc);
+        y = tan(oc / 2) * tan(oc / 2);
+    }
+
+    Angle equation_of_time(julian_date::julian_century tp) const {
+        SUN_COUNT(noaa_equation_of_time);
+        auto I2 = geometric_mean_longitude(tp);
+        auto J2 = geometric_mean_anomaly(tp);
+        auto K2 = ecc;
+
+        auto V2 = y * sin(2 * I2) - 2 * K2 * sin(J2) + 4 * K2 * y * sin(J2) * cos(2 * I2) -
+                  0.5 * y * y * sin(4 * I2) - 1.25 * K2 * K2 * sin(2 * J2);
+        return Angle::from_rad(V2);
+    }
+
+    Angle sun_declination(julian_date::julian_century tp) const {
+        SUN_COUNT(noaa_sun_declination);
+        auto an = geometric_mean_anomaly(tp);
+        auto center = Angle::from_deg(sin(an) * center1 + sin(2 * an) * center2 + sin(3 * an) * 0.000289);
+        auto al = geometric_mean_longitude(tp) + center - Angle::from_deg(aberration);
+        return Angle::from_rad(asin(sin_oc * sin(al)));
+    }
+
+    Angle geometric_mean_longitude(julian_date::julian_century tp) const {
+        auto t = t0.time_since_epoch().count();
+        auto dt = (tp - t0).count();
+        return Angle::from_deg(mean_lon + dt * (36000.76983 + 0.0003032 * (2 * t + dt)));
+    }
+
+    Angle geometric_mean_anomaly(julian_date::julian_century tp) const {
+        auto t = t0.time_since_epoch().count();
+        auto dt = (tp - t0).count();
+        return Angle::from_deg(mean_anom + dt * (35999.05029 - 0.0001537 * (2 * t + dt)));
+    }
+
+    // The prepared terms are plain doubles in degrees (or unitless) so the SoA kernel can use them directly.
+    julian_date::julian_century t0;
+    double mean_lon;
+    double mean_anom;
+    double ecc;
+    double center1;
+    double center2;
+    double aberration;
+    double sin_oc;
+    double y;
+};
+
+#endif//SOLAR_CALCULATIONS_NOAA_TERMS_H
@@ -26,7 +26,10 @@
 // clang-format off
 
 #include <math.h>
+#include <stddef.h>
+#include <stdint.h>
 
+#include "noaa_core.h"
 #include "redshift_solar.h"
 #include "time.h"
 
@@ -34,29 +37,6 @@
 #define DEG(x)  ((x)*(180/M_PI))
 
 
-/* Angels of various times of day. */
-static const double time_angle[] = {
-	[SOLAR_TIME_ASTRO_DAWN] = RAD(-90.0 + SOLAR_ASTRO_TWILIGHT_ELEV),
-	[SOLAR_TIME_NAUT_DAWN] = RAD(-90.0 + SOLAR_NAUT_TWILIGHT_ELEV),
-	[SOLAR_TIME_CIVIL_DAWN] = RAD(-90.0 + SOLAR_CIVIL_TWILIGHT_ELEV),
-	[SOLAR_TIME_SUNRISE] = RAD(-90.0 + SOLAR_DAYTIME_ELEV),
-	[SOLAR_TIME_NOON] = RAD(0.0),
-	[SOLAR_TIME_SUNSET] = RAD(90.0 - SOLAR_DAYTIME_ELEV),
-	[SOLAR_TIME_CIVIL_DUSK] = RAD(90.0 - SOLAR_CIVIL_TWILIGHT_ELEV),
-	[SOLAR_TIME_NAUT_DUSK] = RAD(90.0 - SOLAR_NAUT_TWILIGHT_ELEV),
-	[SOLAR_TIME_ASTRO_DUSK] = RAD(90.0 - SOLAR_ASTRO_TWILIGHT_ELEV)
-};
-
-
-/* Unix epoch from Julian day */
-static double
-epoch_from_jd(double jd)
-{
-	return 86400.0*(jd - 2440587.5);
-}
-
-
-
 /* Julian day from unix epoch */
 static double
 jd_from_epoch(double t)
@@ -192,19 +172,6 @@ equation_of_time(double t)
 	return 4*DEG(eq_time);
 }
 
-/* Hour angle at the location for the given angular elevation.
-   lat: Latitude of location in degrees
-   decl: Declination in radians
-   elev: Angular elevation angle in radians
-   Return: Hour angle in radians */
-static double
-hour_angle_from_elevation(double lat, double decl, double elev)
-{
-	double omega = acos((cos(fabs(elev)) - sin(RAD(lat))*sin(decl))/
-			    (cos(RAD(lat))*cos(decl)));
-	return copysign(omega, -elev);
-}
-
 /* Angular elevation at the location for the given hour angle.
    lat: Latitude of location in degrees
    decl: Declination in radians
@@ -217,57 +184,6 @@ elevation_from_hour_angle(double lat, double decl, double ha)
 		    sin(RAD(lat))*sin(decl));
 }
 
-/* Time of apparent solar noon of location on earth.
-   t: Julian centuries since J2000.0
-   lon: Longitude of location in degrees
-   Return: Time difference from mean solar midnigth in minutes */
-static double
-time_of_solar_noon(double t, double lon)
-{
-	/* First pass uses approximate solar noon to
-	   calculate equation of time. */
-	double t_noon = jcent_from_jd(jd_from_jcent(t) - lon/360.0);
-	double eq_time = equation_of_time(t_noon);
-	double sol_noon = 720 - 4*lon - eq_time;
-
-	/* Recalculate using new solar noon. */
-	t_noon = jcent_from_jd(jd_from_jcent(t) - 0.5 + sol_noon/1440.0);
-	eq_time = equation_of_time(t_noon);
-	sol_noon = 720 - 4*lon - eq_time;
-
-	/* No need to do more iterations */
-	return sol_noon;
-}
-
-/* Time of given apparent solar angular elevation of location on earth.
-   t: Julian centuries since J2000.0
-   t_noon: Apparent solar noon in Julian centuries since J2000.0
-   lat: Latitude of location in degrees
-   lon: Longtitude of location in degrees
-   elev: Solar angular elevation in radians
-   Return: Time difference from mean solar midnight in minutes */
-static double
-time_of_solar_elevation(double t, double t_noon,
-			double lat, double lon, double elev)
-{
-	/* First pass uses approximate sunrise to
-	   calculate equation of time. */
-	double eq_time = equation_of_time(t_noon);
-	double sol_decl = solar_declination(t_noon);
-	double ha = hour_angle_from_elevation(lat, sol_decl, elev);
-	double sol_offset = 720 - 4*(lon + DEG(ha)) - eq_time;
-
-	/* Recalculate using new sunrise. */
-	double t_rise = jcent_from_jd(jd_from_jcent(t) - 0.5 + sol_offset/1440.0);
-	eq_time = equation_of_time(t_rise);
-	sol_decl = solar_declination(t_rise);
-	ha = hour_angle_from_elevation(lat, sol_decl, elev);
-	sol_offset = 720 - 4*(lon + DEG(ha)) - eq_time;
-
-	/* No need to do more iterations */
-	return sol_offset;
-}
-
 /* Solar angular elevation at the given location and time.
    t: Julian centuries since J2000.0
    lat: Latitude of location
@@ -298,30 +214,67 @@ solar_elevation(double date, double lat, double lon)
 	return DEG(solar_elevation_from_time(jcent_from_jd(jd), lat, lon));
 }
 
+/* Calculate the times of noon, midnight and the events in mask, a bit
+   mask of (1 << solar_time_t) values. Entries not in mask are set to NAN,
+   except noon and midnight, which are always calculated. The times are
+   those of noaa_core_sun_times, in doubles.
+   date: Seconds since unix epoch
+   lat: Latitude of location
+   lon: Longitude of location
+   table: Array of SOLAR_TIME_MAX entries to fill
+   mask: Which entries to calculate */
+void
+solar_table_fill_mask(double date, double lat, double lon, double *table,
+		      unsigned int mask)
+{
+	int64_t times[SOLAR_TIME_MAX];
+	noaa_core_sun_times(lat, lon, (int64_t)floor(date), mask, times);
+	for (int e = 0; e < SOLAR_TIME_MAX; e++) {
+		table[e] = times[e] != NOAA_CORE_NONE ? (double)times[e] : NAN;
+	}
+}
+
 void
 solar_table_fill(double date, double lat, double lon, double *table)
 {
-	/* Calculate Julian day */
-	double jd = jd_from_epoch(date);
+	solar_table_fill_mask(date, lat, lon, table, SOLAR_TIME_ALL);
+}
 
-	/* Calculate Julian day number */
-	double jdn = round(jd);
-	double t = jcent_from_jd(jdn);
-
-	/* Calculate apparent solar noon */
-	double sol_noon = time_of_solar_noon(t, lon);
-	double j_noon = jdn - 0.5 + sol_noon/1440.0;
-	double t_noon = jcent_from_jd(j_noon);
-	table[SOLAR_TIME_NOON] = epoch_from_jd(j_noon);
-
-	/* Calculate solar midnight */
-	table[SOLAR_TIME_MIDNIGHT] = epoch_from_jd(j_noon + 0.5);
-
-	/* Calulate absoute time of other phenomena */
-	for (int i = 2; i < SOLAR_TIME_MAX; i++) {
-		double angle = time_angle[i];
-		double offset =
-			time_of_solar_elevation(t, t_noon, lat, lon, angle);
-		table[i] = epoch_from_jd(jdn - 0.5 + offset/1440.0);
+/* Locations per block of solar_table_fill_batch. */
+#define SOLAR_BATCH_BLOCK  64
+
+/* Same as solar_table_fill_mask, for count locations at the same date.
+   The times come from noaa_core_sun_times_batch, which this only converts
+   to seconds in doubles, with NAN for the events that don't happen.
+   date: Seconds since unix epoch
+   lat: Array of count latitudes
+   lon: Array of count longitudes
+   count: Number of locations
+   table: Table of SOLAR_TIME_MAX rows of stride entries, where entry
+     i of row solar_time_t e, table[e*stride + i], is for location i
+   stride: Distance between rows, at least count
+   mask: Which entries to calculate */
+void
+solar_table_fill_batch(double date, const double *restrict lat,
+		       const double *restrict lon, size_t count,
+		       double *restrict table, size_t stride,
+		       unsigned int mask)
+{
+	int64_t times[SOLAR_TIME_MAX*SOLAR_BATCH_BLOCK];
+	int64_t day = (int64_t)floor(date);
+
+	for (size_t first = 0; first < count; first += SOLAR_BATCH_BLOCK) {
+		size_t n = count - first < SOLAR_BATCH_BLOCK ?
+			count - first : SOLAR_BATCH_BLOCK;
+		noaa_core_sun_times_batch(lat + first, lon + first, n, day,
+					  mask, times, 1, SOLAR_BATCH_BLOCK);
+		for (int e = 0; e < SOLAR_TIME_MAX; e++) {
+			const int64_t *from = times + e*SOLAR_BATCH_BLOCK;
+			double *row = table + e*stride + first;
+			for (size_t i = 0; i < n; i++) {
+				row[i] = from[i] != NOAA_CORE_NONE ?
+					(double)from[i] : NAN;
+			}
+		}
 	}
 }
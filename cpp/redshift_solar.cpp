@@ -1,7 +1,9 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 // SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
 
+#include "instrumentation.h"
 #include "sun.h"
+#include <algorithm>
 
 extern "C" {
 #include "redshift_solar.h"
@@ -11,25 +13,72 @@ using date::sys_seconds;
 using std::optional;
 using std::chrono::seconds;
 
-auto sun::get_sun_times_c(Angle latitude, Angle longitude, date::sys_days date) -> sun_times {
-    double res[SOLAR_TIME_MAX];
-    auto d_epoch = static_cast<double>(std::chrono::duration_cast<seconds>(date.time_since_epoch()).count());
-    solar_table_fill(d_epoch, latitude.deg(), longitude.deg(), res);
-    auto map = [](double tp) -> optional<sys_seconds> {
+// solar_time_t and sun_event share the same order, so the masks are the same, too.
+static_assert(SOLAR_TIME_MAX == sun::sun_event_count && SOLAR_TIME_ALL == sun::all_sun_events);
+
+static auto epoch_of(date::sys_days date) -> double {
+    return static_cast<double>(std::chrono::duration_cast<seconds>(date.time_since_epoch()).count());
+}
+
+// Maps entry i of a table filled by solar_table_fill_batch with the given stride
+static auto sun_times_of(const double *table, std::size_t stride, std::size_t i, sun::sun_event_mask events)
+        -> sun::sun_times {
+    auto map = [&](solar_time_t e) -> optional<sys_seconds> {
+        auto tp = table[e * stride + i];
         if (!std::isnan(tp)) return sys_seconds(seconds(static_cast<size_t>(tp)));
         else
             return std::nullopt;
     };
-    return {
-            sys_seconds(seconds(static_cast<size_t>(res[SOLAR_TIME_NOON]))),
-            sys_seconds(seconds(static_cast<size_t>(res[SOLAR_TIME_MIDNIGHT]))),
-            map(res[SOLAR_TIME_ASTRO_DAWN]),
-            map(res[SOLAR_TIME_NAUT_DAWN]),
-            map(res[SOLAR_TIME_CIVIL_DAWN]),
-            map(res[SOLAR_TIME_SUNRISE]),
-            map(res[SOLAR_TIME_SUNSET]),
-            map(res[SOLAR_TIME_CIVIL_DUSK]),
-            map(res[SOLAR_TIME_NAUT_DUSK]),
-            map(res[SOLAR_TIME_ASTRO_DUSK]),
+    sun::sun_times res = {
+            sys_seconds(seconds(static_cast<size_t>(table[SOLAR_TIME_NOON * stride + i]))),
+            sys_seconds(seconds(static_cast<size_t>(table[SOLAR_TIME_MIDNIGHT * stride + i]))),
+            map(SOLAR_TIME_ASTRO_DAWN),
+            map(SOLAR_TIME_NAUT_DAWN),
+            map(SOLAR_TIME_CIVIL_DAWN),
+            map(SOLAR_TIME_SUNRISE),
+            map(SOLAR_TIME_SUNSET),
+            map(SOLAR_TIME_CIVIL_DUSK),
+            map(SOLAR_TIME_NAUT_DUSK),
+            map(SOLAR_TIME_ASTRO_DUSK),
+            events,
     };
+    SUN_COUNT(redshift_sun_times);
+    SUN_COUNT_MISSING(redshift_missing_events, res);
+    return res;
+}
+
+auto sun::get_sun_times_c(Angle latitude, Angle longitude, date::sys_days date, sun_event_mask events) -> sun_times {
+    double res[SOLAR_TIME_MAX];
+    events = (events & all_sun_events) | sun_event::noon | sun_event::midnight;
+    {
+        SUN_TIME(redshift_call_ns);
+        solar_table_fill_mask(epoch_of(date), latitude.deg(), longitude.deg(), res, events);
+    }
+    SUN_TIME(redshift_convert_ns);
+    return sun_times_of(res, 1, 0, events);
+}
+
+void sun::get_sun_times_c(const location *locations, std::size_t count, date::sys_days date, sun_times *out,
+                          sun_event_mask events) {
+    // Chunks of locations go through the batch, so the table stays small enough for the cache
+    constexpr std::size_t chunk = 256;
+    double latitudes[chunk], longitudes[chunk], table[SOLAR_TIME_MAX * chunk];
+    events = (events & all_sun_events) | sun_event::noon | sun_event::midnight;
+    const auto d_epoch = epoch_of(date);
+    for (std::size_t first = 0; first < count; first += chunk) {
+        const auto n = std::min(chunk, count - first);
+        {
+            SUN_TIME(redshift_convert_ns);
+            for (std::size_t i = 0; i < n; i++) {
+                latitudes[i] = locations[first + i].latitude.deg();
+                longitudes[i] = locations[first + i].longitude.deg();
+            }
+        }
+        {
+            SUN_TIME(redshift_call_ns);
+            solar_table_fill_batch(d_epoch, latitudes, longitudes, n, table, chunk, events);
+        }
+        SUN_TIME(redshift_convert_ns);
+        for (std::size_t i = 0; i < n; i++) { out[first + i] = sun_times_of(table, chunk, i, events); }
+    }
 }
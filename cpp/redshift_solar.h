@@ -22,6 +22,8 @@
 #ifndef REDSHIFT_SOLAR_H
 #define REDSHIFT_SOLAR_H
 
+#include <stddef.h>
+
 #include "time.h"
 
 /* Model of atmospheric refraction near horizon (in degrees). */
@@ -46,8 +48,16 @@ typedef enum {
 	SOLAR_TIME_MAX
 } solar_time_t;
 
+/* Mask of all solar_time_t values for solar_table_fill_mask. */
+#define SOLAR_TIME_ALL  ((1u << SOLAR_TIME_MAX) - 1)
+
 
 double solar_elevation(double date, double lat, double lon);
 void solar_table_fill(double date, double lat, double lon, double *table);
+void solar_table_fill_mask(double date, double lat, double lon, double *table,
+			   unsigned int mask);
+void solar_table_fill_batch(double date, const double *lat, const double *lon,
+			    size_t count, double *table, size_t stride,
+			    unsigned int mask);
 
 #endif /* ! REDSHIFT_SOLAR_H */
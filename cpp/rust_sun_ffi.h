@@ -2,6 +2,7 @@
 #define SOLAR_CALCULATIONS_FFI_H
 
 extern "C" {
+#include <stddef.h>
 #include <stdint.h>
 
 struct sun_times_r {
@@ -18,6 +19,12 @@ struct sun_times_r {
 };
 
 sun_times_r get_sun_times_r(double latitude, double longitude, int64_t date);
+// mask has the same bits as sun::sun_event_mask. Events not in it are 0, like those that don't happen.
+sun_times_r get_sun_times_mask_r(double latitude, double longitude, int64_t date, uint32_t mask);
+// Like get_sun_times_mask_r for count locations (in degrees) on days dates in a row, starting at the date of
+// first_date. out[day * count + location] gets the results, so it needs room for count * days of them.
+void get_sun_times_batch_r(const double *latitude, const double *longitude, size_t count, int64_t first_date,
+                           size_t days, uint32_t mask, sun_times_r *out);
 }
 
 #endif//SOLAR_CALCULATIONS_FFI_H
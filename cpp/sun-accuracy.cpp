@@ -0,0 +1,287 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
+
+// Runs a grid of locations and dates through every backend and compares all events with sun::noaa::get_sun_times.
+// Prints, per backend and latitude band, how far off the events are and how long a call takes, as a markdown table.
+// The comparison runs on many threads, the time per call is measured apart from it on one, so it doesn't depend on how
+// many threads share the cores.
+
+#include "instrumentation.h"
+#include "sun.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fmt/format.h>
+#include <functional>
+#include <thread>
+#include <vector>
+
+using date::days;
+using date::sys_days;
+using date::sys_seconds;
+using std::optional;
+
+namespace {
+    // Deviations in whole seconds, counted exactly up to max_tracked. Everything above only goes into the last bucket
+    // and max, which is enough for percentiles as long as they are in range.
+    struct deviation_stats {
+        static constexpr std::size_t max_tracked = 3600;
+
+        std::vector<std::uint64_t> histogram = std::vector<std::uint64_t>(max_tracked + 2);
+        std::int64_t max = 0;
+        // Events that happen with the backend, but not with the reference, or the other way around
+        std::uint64_t mismatches = 0;
+        std::uint64_t events = 0;
+
+        void add(optional<sys_seconds> value, optional<sys_seconds> reference) {
+            events++;
+            if (value.has_value() != reference.has_value()) {
+                mismatches++;
+                return;
+            }
+            if (!value) return;
+            const auto deviation = std::abs((*value - *reference).count());
+            max = std::max<std::int64_t>(max, deviation);
+            histogram[std::min<std::size_t>(deviation, max_tracked + 1)]++;
+        }
+
+        void add(const sun::sun_times &value, const sun::sun_times &reference) {
+            add(value.noon, reference.noon);
+            add(value.midnight, reference.midnight);
+            add(value.astro_dawn, reference.astro_dawn);
+            add(value.naut_dawn, reference.naut_dawn);
+            add(value.civil_dawn, reference.civil_dawn);
+            add(value.sunrise, reference.sunrise);
+            add(value.sunset, reference.sunset);
+            add(value.civil_dusk, reference.civil_dusk);
+            add(value.naut_dusk, reference.naut_dusk);
+            add(value.astro_dusk, reference.astro_dusk);
+        }
+
+        void merge(const deviation_stats &other) {
+            for (std::size_t i = 0; i < histogram.size(); i++) { histogram[i] += other.histogram[i]; }
+            max = std::max(max, other.max);
+            mismatches += other.mismatches;
+            events += other.events;
+        }
+
+        // Returns the deviation that share of the compared events are within, or -1 if that's above max_tracked
+        [[nodiscard]] std::int64_t percentile(double share) const {
+            std::uint64_t total = 0;
+            for (auto count: histogram) { total += count; }
+            const auto wanted = static_cast<std::uint64_t>(std::ceil(share * static_cast<double>(total)));
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i <= max_tracked; i++) {
+                seen += histogram[i];
+                if (seen >= wanted) return static_cast<std::int64_t>(i);
+            }
+            return -1;
+        }
+    };
+
+    struct backend {
+        const char *name;
+        std::function<void(const std::vector<sun::location> &, sys_days, sun::sun_times *)> run;
+    };
+
+    struct band {
+        const char *name;
+        double min_latitude;
+    };
+}// namespace
+
+// Device classes by how far from the equator they are, as the polar branches of the calculation behave differently
+static constexpr band bands[] = {
+        {"0-60", 0},
+        {"60-70", 60},
+        {"70-90", 70},
+};
+static constexpr std::size_t band_count = std::size(bands);
+
+// Wraps a single location backend to run over all locations
+template<typename F>
+static auto each(F f) {
+    return [f](const std::vector<sun::location> &locations, sys_days date, sun::sun_times *out) {
+        for (std::size_t i = 0; i < locations.size(); i++) {
+            out[i] = f(locations[i].latitude, locations[i].longitude, date);
+        }
+    };
+}
+
+// get_sun_times_approx at precision P
+template<trig_precision P>
+static auto approximated() {
+    return each([](Angle lat, Angle lon, sys_days date) { return sun::noaa::get_sun_times_approx<P>(lat, lon, date); });
+}
+
+// The SoA kernel in precision T, from Angle or AngleF arrays, with its columns converted back into sun_times
+template<typename T>
+static auto soa() {
+    return [](const std::vector<sun::location> &locations, sys_days date, sun::sun_times *out) {
+        const auto count = locations.size();
+        std::vector<basic_angle<T>> latitudes, longitudes;
+        for (const auto &l: locations) {
+            latitudes.emplace_back(l.latitude);
+            longitudes.emplace_back(l.longitude);
+        }
+        std::vector<double> buf(sun::sun_event_count * count);
+        auto column = [&](sun::sun_event e) { return buf.data() + static_cast<std::size_t>(e) * count; };
+        const auto columns = sun::noaa::sun_times_soa{
+                column(sun::sun_event::noon),       column(sun::sun_event::midnight),
+                column(sun::sun_event::astro_dawn), column(sun::sun_event::naut_dawn),
+                column(sun::sun_event::civil_dawn), column(sun::sun_event::sunrise),
+                column(sun::sun_event::sunset),     column(sun::sun_event::civil_dusk),
+                column(sun::sun_event::naut_dusk),  column(sun::sun_event::astro_dusk)};
+        sun::noaa::get_sun_times_soa(latitudes.data(), longitudes.data(), count, date, columns);
+
+        auto seconds = [](double s) { return sys_seconds(std::chrono::seconds(static_cast<std::int64_t>(s))); };
+        for (std::size_t i = 0; i < count; i++) {
+            out[i] = sun::sun_times{};
+            out[i].noon = seconds(column(sun::sun_event::noon)[i]);
+            out[i].midnight = seconds(column(sun::sun_event::midnight)[i]);
+            for (auto e = static_cast<std::size_t>(sun::sun_event::astro_dawn); e < sun::sun_event_count; e++) {
+                const auto event = static_cast<sun::sun_event>(e);
+                const auto s = column(event)[i];
+                if (!std::isnan(s)) out[i].*sun::noaa::detail::member_of(event) = seconds(s);
+            }
+        }
+    };
+}
+
+int main(int argc, char **argv) {
+    if (argc > 6) {
+        fmt::print(stderr, "usage: {} [latitude step] [longitude step] [day step] [days] [threads]\n", argv[0]);
+        return 1;
+    }
+    auto arg = [&](int i, double fallback) { return argc > i ? std::atof(argv[i]) : fallback; };
+    const auto lat_step = arg(1, 2.0), lon_step = arg(2, 15.0);
+    const auto day_step = static_cast<int>(arg(3, 3)), day_count = static_cast<int>(arg(4, 366));
+    const auto hw_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    const auto threads = static_cast<unsigned>(arg(5, hw_threads));
+    if (lat_step <= 0 || lon_step <= 0 || day_step <= 0 || day_count <= 0 || threads == 0) {
+        fmt::print(stderr, "all arguments must be positive\n");
+        return 1;
+    }
+
+    const auto first_day = sys_days(date::January / 1 / 2023);
+    const auto ephemeris = sun::noaa::daily_ephemeris(first_day, first_day + days(day_count));
+    const std::vector<backend> backends = {
+            {"noaa",
+             each([](Angle lat, Angle lon, sys_days date) { return sun::noaa::get_sun_times(lat, lon, date); })},
+            {"noaa_opt",
+             each([](Angle lat, Angle lon, sys_days date) { return sun::noaa::get_sun_times_opt(lat, lon, date); })},
+            {"approx_low", approximated<trig_precision::low>()},
+            {"approx_medium", approximated<trig_precision::medium>()},
+            {"approx_high", approximated<trig_precision::high>()},
+            {"noaa_batch",
+             [](const std::vector<sun::location> &locations, sys_days date, sun::sun_times *out) {
+                 sun::noaa::get_sun_times_batch(locations.data(), locations.size(), date, out);
+             }},
+            {"noaa_ephemeris",
+             [&](const std::vector<sun::location> &locations, sys_days date, sun::sun_times *out) {
+                 sun::noaa::get_sun_times_batch(locations.data(), locations.size(), date, out, ephemeris);
+             }},
+            {"noaa_soa", soa<double>()},
+            {"noaa_soa_float", soa<float>()},
+            {"wiki",
+             each([](Angle lat, Angle lon, sys_days date) { return sun::wiki::get_sun_times(lat, lon, date); })},
+            {"noaa_core",
+             each([](Angle lat, Angle lon, sys_days date) { return sun::get_sun_times_core(lat, lon, date); })},
+            {"core_batch",
+             [](const std::vector<sun::location> &locations, sys_days date, sun::sun_times *out) {
+                 sun::get_sun_times_core(locations.data(), locations.size(), date, out);
+             }},
+            {"c", each([](Angle lat, Angle lon, sys_days date) { return sun::get_sun_times_c(lat, lon, date); })},
+            {"rust", each([](Angle lat, Angle lon, sys_days date) { return sun::get_sun_times_rust(lat, lon, date); })},
+    };
+
+    // The grid, split up by band. Both hemispheres go into the same band.
+    std::vector<sun::location> locations[band_count];
+    for (auto lat = -90.0; lat <= 90.0; lat += lat_step) {
+        auto b = band_count - 1;
+        while (std::abs(lat) < bands[b].min_latitude) { b--; }
+        for (auto lon = -180.0; lon < 180.0; lon += lon_step) {
+            locations[b].push_back({Angle::from_deg(lat), Angle::from_deg(lon)});
+        }
+    }
+
+    // Every thread takes every threads-th day and keeps its own stats, which are merged at the end
+    using thread_stats = std::vector<std::array<deviation_stats, band_count>>;
+    std::vector<thread_stats> stats(threads, thread_stats(backends.size()));
+    auto work = [&](unsigned thread) {
+        auto &own = stats[thread];
+        std::vector<sun::sun_times> reference, out;
+        const auto stride = static_cast<int>(threads) * day_step;
+        for (auto day = static_cast<int>(thread) * day_step; day < day_count; day += stride) {
+            const auto date = first_day + days(day);
+            for (std::size_t b = 0; b < band_count; b++) {
+                reference.resize(locations[b].size());
+                out.resize(locations[b].size());
+                backends.front().run(locations[b], date, reference.data());
+                for (std::size_t i = 0; i < backends.size(); i++) {
+                    auto &s = own[i][b];
+                    backends[i].run(locations[b], date, out.data());
+                    for (std::size_t j = 0; j < out.size(); j++) { s.add(out[j], reference[j]); }
+                }
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++) { pool.emplace_back(work, t); }
+    work(0);
+    for (auto &t: pool) { t.join(); }
+
+    // The time per call on this thread alone, for every band on timed_dates dates spread over the range, after a call
+    // that isn't timed to warm up the caches and the lazy setup of the backend
+    constexpr int timed_dates = 12;
+    std::vector<std::array<double, band_count>> ns_per_call(backends.size());
+    {
+        std::vector<sun::sun_times> out;
+        for (std::size_t i = 0; i < backends.size(); i++) {
+            for (std::size_t b = 0; b < band_count; b++) {
+                out.resize(locations[b].size());
+                if (out.empty()) continue;
+                backends[i].run(locations[b], first_day, out.data());
+                std::chrono::nanoseconds time{0};
+                for (int d = 0; d < timed_dates; d++) {
+                    const auto date = first_day + days(d * day_count / timed_dates);
+                    const auto start = std::chrono::steady_clock::now();
+                    backends[i].run(locations[b], date, out.data());
+                    time += std::chrono::steady_clock::now() - start;
+                }
+                ns_per_call[i][b] = static_cast<double>(time.count()) / static_cast<double>(timed_dates * out.size());
+            }
+        }
+    }
+
+    std::size_t location_count = 0;
+    for (const auto &l: locations) { location_count += l.size(); }
+    fmt::print("{} locations ({}° x {}°), every {}. of {} days from 2023-01-01, {} threads, reference noaa, "
+               "ns/call on one thread\n\n",
+               location_count, lat_step, lon_step, day_step, day_count, threads);
+    fmt::print("| backend        | band  | max s | p99 s | p50 s | mismatches      | ns/call |\n");
+    fmt::print("|----------------|-------|------:|------:|------:|----------------:|--------:|\n");
+    auto percentile = [](std::int64_t value) {
+        return value < 0 ? fmt::format(">{}", deviation_stats::max_tracked) : fmt::format("{}", value);
+    };
+    for (std::size_t i = 0; i < backends.size(); i++) {
+        for (std::size_t b = 0; b < band_count; b++) {
+            deviation_stats total;
+            for (const auto &s: stats) { total.merge(s[i][b]); }
+            if (!total.events) continue;
+            const auto ns = ns_per_call[i][b];
+            fmt::print("| {:<14} | {:<5} | {:>5} | {:>5} | {:>5} | {:>6} ({:>5.2f}%) | {:>7.0f} |\n", backends[i].name,
+                       bands[b].name, total.max, percentile(total.percentile(0.99)),
+                       percentile(total.percentile(0.5)), total.mismatches,
+                       100.0 * static_cast<double>(total.mismatches) / static_cast<double>(total.events), ns);
+        }
+    }
+
+    // Built with SUN_INSTRUMENTATION, also show what all of that took
+    if constexpr (sun::instrumentation::enabled) {
+        fmt::print("\n");
+        sun::instrumentation::dump(stdout);
+    }
+}
@@ -0,0 +1,612 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
+
+// A small HTTP server for devices that fetch their sun_times over the network instead of calculating them, and a load
+// generator to measure it with.
+//
+//   sun-server serve [--port 8080] [--threads 64] [--cell 0.1] [--batch 256] [--window 200]
+//   sun-server load [--host 127.0.0.1] [--port 8080] [--rate 1000,2000,4000] [--seconds 5] [--connections 16]
+//                   [--devices 10000] [--spread 1]
+//
+// GET /times?lat=52.02&lon=8.53&date=2023-06-21 returns the events in UTC as JSON, for the current UTC date if there
+// is no date. They are those of the cell of a sun_times_cache with cells of --cell degrees, so all devices in a cell
+// share one calculation. Under boot storms, many devices ask for the same cells at the same moment, so a request for
+// a cell and date that is already being calculated waits for that result instead of asking again, and the misses
+// that arrive within --window microseconds of each other, up to --batch of them, are calculated in one batch get of
+// the cache, several per instruction. GET /stats returns the counters and a histogram of the latencies from reading
+// a request to having written its response, in microseconds.
+//
+// Every connection is served by one of --threads threads, up to that many at once, the others wait to be accepted.
+//
+// The load generator sends GET /times for --devices random locations within --spread degrees around Bielefeld, at a
+// fixed rate over --connections connections for --seconds seconds, then the next rate, and prints the percentiles of
+// their latencies. It is open loop: every request has a scheduled time, and its latency counts from there, so a slow
+// server can't hide its queueing by slowing the generator down. At the end, it prints the /stats of the server.
+
+#include "sun.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fmt/format.h>
+#include <future>
+#include <map>
+#include <mutex>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+using date::sys_days;
+using date::sys_seconds;
+using std::chrono::steady_clock;
+
+namespace {
+    // Latencies in microseconds, in buckets of a quarter of a power of two each, so percentiles are at most a quarter
+    // above the real ones. Counting is lock-free, for many threads at once.
+    struct latency_histogram {
+        static constexpr std::size_t buckets = 160;
+
+        void add(std::chrono::nanoseconds latency) {
+            const auto us = static_cast<std::uint64_t>(std::max<std::int64_t>(latency.count() / 1000, 0));
+            counts[std::min(index_of(us), buckets - 1)].fetch_add(1, std::memory_order_relaxed);
+            auto seen = max_us.load(std::memory_order_relaxed);
+            while (us > seen && !max_us.compare_exchange_weak(seen, us, std::memory_order_relaxed)) {}
+        }
+
+        [[nodiscard]] std::uint64_t count() const {
+            std::uint64_t res = 0;
+            for (auto &c: counts) { res += c.load(std::memory_order_relaxed); }
+            return res;
+        }
+
+        // Returns the upper end of the bucket that contains the q-quantile, or 0 if nothing was counted
+        [[nodiscard]] std::uint64_t percentile(double q) const {
+            const auto total = count();
+            if (total == 0) return 0;
+            const auto target = std::max<std::uint64_t>(static_cast<std::uint64_t>(std::ceil(q * total)), 1);
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i < buckets; i++) {
+                seen += counts[i].load(std::memory_order_relaxed);
+                if (seen >= target) return std::min(lower_of(i + 1) - 1, max());
+            }
+            return max();
+        }
+
+        [[nodiscard]] std::uint64_t max() const { return max_us.load(std::memory_order_relaxed); }
+
+        // Returns the non-empty buckets as a JSON array of [upper end, count] pairs
+        [[nodiscard]] std::string json() const {
+            std::string res = "[";
+            for (std::size_t i = 0; i < buckets; i++) {
+                if (const auto c = counts[i].load(std::memory_order_relaxed)) {
+                    res += fmt::format("{}[{},{}]", res.size() > 1 ? "," : "", lower_of(i + 1) - 1, c);
+                }
+            }
+            return res + "]";
+        }
+
+        // 0..3 get a bucket each, then every [2^k, 2^(k+1)) is split into four
+        static std::size_t index_of(std::uint64_t us) {
+            if (us < 4) return us;
+            const auto k = static_cast<std::size_t>(63 - __builtin_clzll(us));
+            return 4 * (k - 1) + ((us >> (k - 2)) & 3);
+        }
+
+        static std::uint64_t lower_of(std::size_t index) {
+            if (index < 4) return index;
+            return (4 + index % 4) << (index / 4 - 1);
+        }
+
+        std::array<std::atomic<std::uint64_t>, buckets> counts{};
+        std::atomic<std::uint64_t> max_us{0};
+    };
+
+    constexpr const char *event_names[sun::sun_event_count] = {
+            "noon",    "midnight", "astro_dawn", "naut_dawn", "civil_dawn",
+            "sunrise", "sunset",   "civil_dusk", "naut_dusk", "astro_dusk",
+    };
+
+    std::string iso_date(sys_days day) {
+        const auto ymd = date::year_month_day(day);
+        return fmt::format("{:04}-{:02}-{:02}", static_cast<int>(ymd.year()), static_cast<unsigned>(ymd.month()),
+                           static_cast<unsigned>(ymd.day()));
+    }
+
+    std::string iso_time(sys_seconds time) {
+        const auto day = date::floor<date::days>(time);
+        const auto s = (time - day).count();
+        return fmt::format("{}T{:02}:{:02}:{:02}Z", iso_date(day), s / 3600, s / 60 % 60, s % 60);
+    }
+
+    std::string lowercase(std::string_view s) {
+        std::string res(s);
+        std::transform(res.begin(), res.end(), res.begin(), [](unsigned char c) { return std::tolower(c); });
+        return res;
+    }
+
+    enum class read_result {
+        ok,
+        // End of file, an error or headers over 64 kB
+        closed,
+        // A Content-Length that isn't a number or is over the limit
+        bad_length,
+    };
+
+    // Reads one HTTP message from fd into message, with its body if it has a Content-Length of up to max_body bytes.
+    // buf keeps what was read beyond it, for the next message on the connection.
+    read_result read_message(int fd, std::string &buf, std::string &message, std::size_t max_body) {
+        constexpr std::size_t max_header = 64 * 1024;
+        char chunk[16 * 1024];
+        auto fill = [&]() {
+            const auto n = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) return false;
+            buf.append(chunk, static_cast<std::size_t>(n));
+            return true;
+        };
+
+        auto end = buf.find("\r\n\r\n");
+        while (end == std::string::npos) {
+            if (buf.size() > max_header || !fill()) return read_result::closed;
+            end = buf.find("\r\n\r\n");
+        }
+        end += 4;
+        const auto head = lowercase(std::string_view(buf).substr(0, end));
+        if (const auto at = head.find("\r\ncontent-length:"); at != std::string::npos) {
+            auto digits = std::string_view(head).substr(at + 17);
+            digits = digits.substr(0, digits.find("\r\n"));
+            while (!digits.empty() && (digits.front() == ' ' || digits.front() == '\t')) { digits.remove_prefix(1); }
+            while (!digits.empty() && (digits.back() == ' ' || digits.back() == '\t')) { digits.remove_suffix(1); }
+            // Digits only, and at most max_body, which also keeps end from overflowing
+            std::size_t length = 0;
+            if (digits.empty()) return read_result::bad_length;
+            for (const auto c: digits) {
+                if (c < '0' || c > '9') return read_result::bad_length;
+                length = length * 10 + static_cast<std::size_t>(c - '0');
+                if (length > max_body) return read_result::bad_length;
+            }
+            end += length;
+            while (buf.size() < end) {
+                if (!fill()) return read_result::closed;
+            }
+        }
+        message.assign(buf, 0, end);
+        buf.erase(0, end);
+        return read_result::ok;
+    }
+
+    bool write_all(int fd, std::string_view data) {
+        while (!data.empty()) {
+            const auto n = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            data.remove_prefix(static_cast<std::size_t>(n));
+        }
+        return true;
+    }
+
+    // Returns the value of the query parameter name in target, or an empty view
+    std::string_view query_parameter(std::string_view target, std::string_view name) {
+        const auto query = target.find('?');
+        if (query == std::string_view::npos) return {};
+        auto rest = target.substr(query + 1);
+        while (!rest.empty()) {
+            const auto amp = rest.find('&');
+            const auto pair = rest.substr(0, amp);
+            if (pair.size() > name.size() && pair.substr(0, name.size()) == name && pair[name.size()] == '=') {
+                return pair.substr(name.size() + 1);
+            }
+            if (amp == std::string_view::npos) break;
+            rest.remove_prefix(amp + 1);
+        }
+        return {};
+    }
+
+    std::optional<double> parse_number(std::string_view s) {
+        const auto str = std::string(s);
+        char *end = nullptr;
+        const auto res = std::strtod(str.c_str(), &end);
+        if (str.empty() || *end != '\0' || !std::isfinite(res)) return std::nullopt;
+        return res;
+    }
+
+    std::optional<sys_days> parse_date(std::string_view s) {
+        int y;
+        unsigned m, d;
+        char rest;
+        if (std::sscanf(std::string(s).c_str(), "%d-%u-%u%c", &y, &m, &d, &rest) != 3) return std::nullopt;
+        const auto ymd = date::year(y) / m / d;
+        if (!ymd.ok()) return std::nullopt;
+        return sys_days(ymd);
+    }
+
+    // The cell and date a request is for, to find those that are being calculated already
+    struct request_key {
+        double latitude;
+        double longitude;
+        std::int64_t day;
+
+        bool operator==(const request_key &other) const {
+            return latitude == other.latitude && longitude == other.longitude && day == other.day;
+        }
+    };
+
+    struct request_key_hash {
+        std::size_t operator()(const request_key &key) const {
+            const auto h = std::hash<double>{}(key.latitude) * 31 + std::hash<double>{}(key.longitude);
+            return h * 0x9e3779b97f4a7c15 ^ static_cast<std::size_t>(key.day);
+        }
+    };
+
+    struct server {
+        server(Angle cell_size, std::size_t max_batch, std::chrono::microseconds window)
+            : cache(cell_size), max_batch(std::max<std::size_t>(max_batch, 1)), window(window) {}
+
+        // Returns the sun_times of the cell of a location on date: from the cache, from the calculation of the same
+        // cell and date that is under way, or from the next batch. Hits only take the lock of their cache shard, the
+        // server lock is for the requests that miss.
+        sun::sun_times times_of(Angle latitude, Angle longitude, sys_days date) {
+            if (auto hit = cache.find(latitude, longitude, date)) return *hit;
+            const auto cell = cache.cell_of(latitude, longitude);
+            const auto key = request_key{cell.latitude.deg(), cell.longitude.deg(), date.time_since_epoch().count()};
+            std::shared_future<sun::sun_times> result;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                // A batch puts its results into the cache before it takes its requests out of in_flight, so looking
+                // again under the lock finds those that were calculated since the first look
+                if (auto it = in_flight.find(key); it != in_flight.end()) {
+                    coalesced.fetch_add(1, std::memory_order_relaxed);
+                    result = it->second;
+                } else if (auto hit = cache.find(latitude, longitude, date)) {
+                    return *hit;
+                } else {
+                    auto promise = std::promise<sun::sun_times>();
+                    result = promise.get_future().share();
+                    in_flight.emplace(key, result);
+                    if (queue.empty()) first_queued = steady_clock::now();
+                    queue.push_back({key, {latitude, longitude}, date, std::move(promise)});
+                    if (queue.size() == 1 || queue.size() == max_batch) wake.notify_one();
+                }
+            }
+            return result.get();
+        }
+
+        // Runs forever, calculating the queued requests in batches of up to max_batch, each one as soon as it is full
+        // or window after its first request was queued.
+        void run_batches() {
+            std::unique_lock<std::mutex> guard(lock);
+            while (true) {
+                wake.wait(guard, [&] { return !queue.empty(); });
+                wake.wait_until(guard, first_queued + window, [&] { return queue.size() >= max_batch; });
+                const auto n = std::min(queue.size(), max_batch);
+                std::vector<pending> batch(std::make_move_iterator(queue.begin()),
+                                           std::make_move_iterator(queue.begin() + n));
+                queue.erase(queue.begin(), queue.begin() + n);
+                first_queued = steady_clock::now();
+                guard.unlock();
+
+                // One batch per date, which is a single one unless some devices ask for other days than today
+                std::sort(batch.begin(), batch.end(), [](auto &a, auto &b) { return a.key.day < b.key.day; });
+                std::vector<sun::location> locations;
+                std::vector<sun::sun_times> times(batch.size());
+                for (auto &p: batch) { locations.push_back(p.location); }
+                for (std::size_t first = 0, last; first < batch.size(); first = last) {
+                    for (last = first + 1; last < batch.size() && batch[last].key.day == batch[first].key.day;) {
+                        last++;
+                    }
+                    cache.get(locations.data() + first, last - first, batch[first].date, times.data() + first);
+                }
+
+                // The results are in the cache now, so requests for the same cell either got the future or find them
+                guard.lock();
+                for (auto &p: batch) { in_flight.erase(p.key); }
+                guard.unlock();
+                for (std::size_t i = 0; i < batch.size(); i++) { batch[i].promise.set_value(times[i]); }
+                batches.fetch_add(1, std::memory_order_relaxed);
+                batched.fetch_add(batch.size(), std::memory_order_relaxed);
+                auto seen = largest_batch.load(std::memory_order_relaxed);
+                while (batch.size() > seen && !largest_batch.compare_exchange_weak(seen, batch.size())) {}
+                guard.lock();
+            }
+        }
+
+        // Returns the status line and body of the response to a request
+        std::pair<std::string_view, std::string> respond(std::string_view request) {
+            const auto method_end = request.find(' ');
+            const auto target_end = request.find(' ', method_end + 1);
+            if (method_end == std::string_view::npos || target_end == std::string_view::npos) {
+                return {"400 Bad Request", R"({"error":"malformed request"})"};
+            }
+            const auto method = request.substr(0, method_end);
+            const auto target = request.substr(method_end + 1, target_end - method_end - 1);
+            const auto path = target.substr(0, target.find('?'));
+            if (method != "GET") return {"405 Method Not Allowed", R"({"error":"only GET is supported"})"};
+            requests.fetch_add(1, std::memory_order_relaxed);
+
+            if (path == "/stats") return {"200 OK", stats()};
+            if (path != "/times") return {"404 Not Found", R"({"error":"no such path"})"};
+
+            const auto latitude = parse_number(query_parameter(target, "lat"));
+            const auto longitude = parse_number(query_parameter(target, "lon"));
+            if (!latitude || !longitude || std::abs(*latitude) > 90 || std::abs(*longitude) > 180) {
+                return {"400 Bad Request", R"({"error":"lat and lon have to be degrees within ±90 and ±180"})"};
+            }
+            auto date = date::floor<date::days>(std::chrono::system_clock::now());
+            if (const auto param = query_parameter(target, "date"); !param.empty()) {
+                const auto parsed = parse_date(param);
+                if (!parsed) return {"400 Bad Request", R"({"error":"date has to be YYYY-MM-DD"})"};
+                date = *parsed;
+            }
+
+            const auto lat = Angle::from_deg(*latitude), lon = Angle::from_deg(*longitude);
+            const auto times = times_of(lat, lon, date);
+            const auto cell = cache.cell_of(lat, lon);
+            auto body = fmt::format(R"({{"latitude":{:.10g},"longitude":{:.10g},"date":"{}")", cell.latitude.deg(),
+                                    cell.longitude.deg(), iso_date(date));
+            body += fmt::format(R"(,"noon":"{}","midnight":"{}")", iso_time(times.noon), iso_time(times.midnight));
+            for (auto e = static_cast<std::size_t>(sun::sun_event::astro_dawn); e < sun::sun_event_count; e++) {
+                const auto &time = times.*sun::noaa::detail::member_of(static_cast<sun::sun_event>(e));
+                body += time ? fmt::format(R"(,"{}":"{}")", event_names[e], iso_time(*time))
+                             : fmt::format(R"(,"{}":null)", event_names[e]);
+            }
+            return {"200 OK", body + "}"};
+        }
+
+        std::string stats() const {
+            const auto b = batches.load(std::memory_order_relaxed);
+            return fmt::format(R"({{"requests":{},"coalesced":{},"cache_hits":{},"cache_misses":{},"cells":{},)"
+                               R"("batches":{},"mean_batch":{:.1f},"largest_batch":{},)"
+                               R"("latency_us":{{"p50":{},"p90":{},"p99":{},"p999":{},"max":{}}},"histogram_us":{}}})",
+                               requests.load(), coalesced.load(), cache.hits(), cache.misses(), cache.size(), b,
+                               b ? static_cast<double>(batched.load()) / b : 0.0, largest_batch.load(),
+                               latency.percentile(0.5), latency.percentile(0.9), latency.percentile(0.99),
+                               latency.percentile(0.999), latency.max(), latency.json());
+        }
+
+        // Serves the requests on a connection until the client closes it or asks to
+        void serve_connection(int fd) {
+            std::string buf, request;
+            while (true) {
+                // Only GET is served, so requests have no body
+                const auto read = read_message(fd, buf, request, 0);
+                if (read == read_result::bad_length) {
+                    const auto body = std::string_view(R"({"error":"requests can't have a body"})");
+                    write_all(fd, fmt::format("HTTP/1.1 400 Bad Request\r\nContent-Type: application/json\r\n"
+                                              "Content-Length: {}\r\nConnection: close\r\n\r\n{}",
+                                              body.size(), body));
+                }
+                if (read != read_result::ok) break;
+                const auto start = steady_clock::now();
+                const auto [status, body] = respond(request);
+                const auto head = lowercase(std::string_view(request).substr(0, request.find("\r\n\r\n") + 2));
+                const auto close = head.find("\r\nconnection: close\r\n") != std::string::npos ||
+                                   head.find(" http/1.0\r\n") != std::string::npos;
+                const auto response =
+                        fmt::format("HTTP/1.1 {}\r\nContent-Type: application/json\r\nContent-Length: {}\r\n{}\r\n{}",
+                                    status, body.size(), close ? "Connection: close\r\n" : "", body);
+                if (!write_all(fd, response)) break;
+                latency.add(steady_clock::now() - start);
+                if (close) break;
+            }
+            ::close(fd);
+        }
+
+        struct pending {
+            request_key key;
+            sun::location location;
+            sys_days date;
+            std::promise<sun::sun_times> promise;
+        };
+
+        sun::noaa::sun_times_cache cache;
+        const std::size_t max_batch;
+        const std::chrono::microseconds window;
+
+        std::mutex lock;
+        std::condition_variable wake;
+        std::unordered_map<request_key, std::shared_future<sun::sun_times>, request_key_hash> in_flight;
+        std::vector<pending> queue;
+        steady_clock::time_point first_queued;
+
+        std::atomic<std::uint64_t> requests{0}, coalesced{0}, batches{0}, batched{0};
+        std::atomic<std::size_t> largest_batch{0};
+        latency_histogram latency;
+    };
+
+    // The --name value pairs of the command line after the mode, or nullopt if there is one not in names
+    std::optional<std::map<std::string, std::string>> parse_options(int argc, char **argv,
+                                                                     const std::vector<std::string_view> &names) {
+        std::map<std::string, std::string> res;
+        for (int i = 2; i < argc; i += 2) {
+            const auto name = std::string_view(argv[i]);
+            if (i + 1 == argc || name.size() <= 2 || name.substr(0, 2) != "--") return std::nullopt;
+            if (std::find(names.begin(), names.end(), name.substr(2)) == names.end()) return std::nullopt;
+            res[std::string(name.substr(2))] = argv[i + 1];
+        }
+        return res;
+    }
+
+    void set_no_delay(int fd) {
+        const int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    int serve(const std::map<std::string, std::string> &options) {
+        auto option = [&](const char *name, double fallback) {
+            const auto it = options.find(name);
+            return it == options.end() ? fallback : std::atof(it->second.c_str());
+        };
+        const auto port = static_cast<std::uint16_t>(option("port", 8080));
+        const auto threads = static_cast<std::size_t>(std::max(option("threads", 64), 1.0));
+        const auto cell = Angle::from_deg(option("cell", 0.1));
+        auto srv = server(cell, static_cast<std::size_t>(option("batch", 256)),
+                          std::chrono::microseconds(static_cast<std::int64_t>(option("window", 200))));
+
+        const auto listener = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (listener < 0) {
+            fmt::print(stderr, "can't create a socket: {}\n", std::strerror(errno));
+            return 1;
+        }
+        const int one = 1;
+        ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(port);
+        if (::bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+            ::listen(listener, 1024) != 0) {
+            fmt::print(stderr, "can't listen on port {}: {}\n", port, std::strerror(errno));
+            return 1;
+        }
+        fmt::print("listening on port {} with {} threads, cells of {}° (events up to {:.0f} s off up to 60°)\n", port,
+                   threads, cell.deg(), srv.cache.error_bound(Angle::from_deg(60)));
+        std::fflush(stdout);
+
+        auto batcher = std::thread([&] { srv.run_batches(); });
+        std::vector<std::thread> workers;
+        for (std::size_t i = 0; i < threads; i++) {
+            workers.emplace_back([&] {
+                while (true) {
+                    const auto fd = ::accept(listener, nullptr, nullptr);
+                    if (fd < 0) continue;
+                    set_no_delay(fd);
+                    srv.serve_connection(fd);
+                }
+            });
+        }
+        batcher.join();
+        return 0;
+    }
+
+    int connect_to(const std::string &host, const std::string &port) {
+        addrinfo hints{}, *info = nullptr;
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        if (::getaddrinfo(host.c_str(), port.c_str(), &hints, &info) != 0) return -1;
+        auto fd = -1;
+        for (auto *i = info; i && fd < 0; i = i->ai_next) {
+            fd = ::socket(i->ai_family, i->ai_socktype, i->ai_protocol);
+            if (fd >= 0 && ::connect(fd, i->ai_addr, i->ai_addrlen) != 0) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+        ::freeaddrinfo(info);
+        if (fd >= 0) set_no_delay(fd);
+        return fd;
+    }
+
+    int load(const std::map<std::string, std::string> &options) {
+        // The largest body accepted from the server, far more than /times or /stats take
+        constexpr std::size_t max_response = 1024 * 1024;
+        auto option = [&](const char *name, const char *fallback) {
+            const auto it = options.find(name);
+            return it == options.end() ? std::string(fallback) : it->second;
+        };
+        const auto host = option("host", "127.0.0.1"), port = option("port", "8080");
+        const auto seconds = std::atof(option("seconds", "5").c_str());
+        const auto connections = std::max(std::atoi(option("connections", "16").c_str()), 1);
+        const auto spread = std::atof(option("spread", "1").c_str());
+        std::vector<double> rates;
+        for (auto rest = option("rate", "1000,2000,4000"); !rest.empty();) {
+            const auto comma = rest.find(',');
+            rates.push_back(std::atof(rest.substr(0, comma).c_str()));
+            rest = comma == std::string::npos ? "" : rest.substr(comma + 1);
+        }
+
+        std::vector<std::string> requests;
+        auto rng = std::mt19937_64(1);
+        auto offset = std::uniform_real_distribution<double>(-spread / 2, spread / 2);
+        for (auto i = std::max(std::atoi(option("devices", "10000").c_str()), 1); i > 0; i--) {
+            requests.push_back(fmt::format("GET /times?lat={:.5f}&lon={:.5f} HTTP/1.1\r\nHost: {}\r\n\r\n",
+                                           52.02182 + offset(rng), 8.53509 + offset(rng), host));
+        }
+
+        fmt::print("{:>10} {:>10} {:>8} {:>8} {:>8} {:>8} {:>8} {:>7}\n", "rate/s", "done/s", "p50 us", "p90 us",
+                   "p99 us", "p99.9 us", "max us", "errors");
+        for (const auto rate: rates) {
+            const auto total = static_cast<std::size_t>(rate * seconds);
+            const auto start = steady_clock::now() + std::chrono::milliseconds(100);
+            auto scheduled = [&](std::size_t k) {
+                const auto offset = std::chrono::duration<double>(static_cast<double>(k) / rate);
+                return start + std::chrono::duration_cast<steady_clock::duration>(offset);
+            };
+            latency_histogram latency;
+            std::atomic<std::size_t> errors{0};
+            std::vector<std::thread> clients;
+            for (int c = 0; c < connections; c++) {
+                clients.emplace_back([&, c] {
+                    auto device = std::mt19937_64(c + 1);
+                    auto fd = connect_to(host, port);
+                    std::string buf, response;
+                    for (auto k = static_cast<std::size_t>(c); k < total; k += connections) {
+                        std::this_thread::sleep_until(scheduled(k));
+                        if (fd < 0) fd = connect_to(host, port);
+                        const auto &request = requests[device() % requests.size()];
+                        if (fd < 0 || !write_all(fd, request) ||
+                            read_message(fd, buf, response, max_response) != read_result::ok) {
+                            errors++;
+                            if (fd >= 0) ::close(fd);
+                            fd = -1;
+                            buf.clear();
+                            continue;
+                        }
+                        if (response.compare(0, 12, "HTTP/1.1 200") != 0) errors++;
+                        latency.add(steady_clock::now() - scheduled(k));
+                    }
+                    if (fd >= 0) ::close(fd);
+                });
+            }
+            for (auto &t: clients) { t.join(); }
+            const auto elapsed = std::chrono::duration<double>(steady_clock::now() - start).count();
+            fmt::print("{:>10.0f} {:>10.0f} {:>8} {:>8} {:>8} {:>8} {:>8} {:>7}\n", rate, latency.count() / elapsed,
+                       latency.percentile(0.5), latency.percentile(0.9), latency.percentile(0.99),
+                       latency.percentile(0.999), latency.max(), errors.load());
+        }
+
+        std::string buf, response;
+        if (const auto fd = connect_to(host, port); fd >= 0) {
+            if (write_all(fd, fmt::format("GET /stats HTTP/1.1\r\nHost: {}\r\n\r\n", host)) &&
+                read_message(fd, buf, response, max_response) == read_result::ok) {
+                fmt::print("server: {}\n", response.substr(response.find("\r\n\r\n") + 4));
+            }
+            ::close(fd);
+        }
+        return 0;
+    }
+}// namespace
+
+int main(int argc, char **argv) {
+    const auto mode = std::string_view(argc > 1 ? argv[1] : "");
+    if (mode == "serve") {
+        if (const auto options = parse_options(argc, argv, {"port", "threads", "cell", "batch", "window"})) {
+            return serve(*options);
+        }
+    } else if (mode == "load") {
+        const auto names = std::vector<std::string_view>{"host",        "port",    "rate",  "seconds",
+                                                         "connections", "devices", "spread"};
+        if (const auto options = parse_options(argc, argv, names)) return load(*options);
+    }
+    fmt::print(stderr,
+               "usage: {0} serve [--port 8080] [--threads 64] [--cell 0.1] [--batch 256] [--window 200]\n"
+               "       {0} load [--host 127.0.0.1] [--port 8080] [--rate 1000,2000,4000] [--seconds 5]\n"
+               "                [--connections 16] [--devices 10000] [--spread 1]\n",
+               argv[0]);
+    return 1;
+}
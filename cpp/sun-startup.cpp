@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
+
+// Calculates one result with a backend in a fresh process and prints how many nanoseconds that took from the start of
+// main, for BM_startup in cpp/bench_startup.cpp. That is the time to first result of a short-lived CLI tool, with all
+// the lazy setup of the backend, like page faults, the tables of the SoA kernel or, for local, loading the tz database.
+// Only local and cache touch anything beyond the calculation itself. none does nothing, for the cost of the process.
+
+#include "sun.h"
+#include <chrono>
+#include <cstring>
+#include <fmt/format.h>
+
+using date::sys_days;
+using std::chrono::steady_clock;
+
+static constexpr auto lat = Angle::from_deg(52.02182);
+static constexpr auto lon = Angle::from_deg(8.53509);
+static constexpr auto day = sys_days(date::June / 21 / 2023);
+
+// Keeps the results from being optimized away
+static volatile std::int64_t sink;
+
+static void use(const sun::sun_times &times) { sink = times.noon.time_since_epoch().count(); }
+
+static constexpr struct {
+    const char *name;
+    void (*first_result)();
+} backends[] = {
+        {"none", [] {}},
+        {"noaa", [] { use(sun::noaa::get_sun_times(lat, lon, day)); }},
+        {"noaa_opt", [] { use(sun::noaa::get_sun_times_opt(lat, lon, day)); }},
+        {"approx_medium", [] { use(sun::noaa::get_sun_times_approx<trig_precision::medium>(lat, lon, day)); }},
+        {"noaa_batch",
+         [] {
+             const auto location = sun::location{lat, lon};
+             sun::sun_times times;
+             sun::noaa::get_sun_times_batch(&location, 1, day, &times);
+             use(times);
+         }},
+        {"noaa_soa",
+         [] {
+             double buf[sun::sun_event_count];
+             const auto out = sun::noaa::sun_times_soa{buf + 0, buf + 1, buf + 2, buf + 3, buf + 4,
+                                                       buf + 5, buf + 6, buf + 7, buf + 8, buf + 9};
+             sun::noaa::get_sun_times_soa(&lat, &lon, 1, day, out);
+             sink = static_cast<std::int64_t>(buf[0]);
+         }},
+        {"wiki", [] { use(sun::wiki::get_sun_times(lat, lon, day)); }},
+        {"noaa_core", [] { use(sun::get_sun_times_core(lat, lon, day)); }},
+        {"c", [] { use(sun::get_sun_times_c(lat, lon, day)); }},
+        {"rust", [] { use(sun::get_sun_times_rust(lat, lon, day)); }},
+        {"cache",
+         [] {
+             auto cache = sun::noaa::sun_times_cache(Angle::from_deg(0.1));
+             use(cache.get(lat, lon, day));
+         }},
+        {"local",
+         [] {
+             const auto zone = sun::zone_offsets(date::locate_zone("Europe/Berlin"), day, day);
+             const auto local_day = date::local_days(day.time_since_epoch());
+             sink = sun::noaa::get_local_sun_times(lat, lon, local_day, zone).noon.time_since_epoch().count();
+         }},
+};
+
+int main(int argc, char **argv) {
+    const auto start = steady_clock::now();
+    for (const auto &backend: backends) {
+        if (argc == 2 && std::strcmp(argv[1], backend.name) == 0) {
+            backend.first_result();
+            fmt::print("{}\n", std::chrono::nanoseconds(steady_clock::now() - start).count());
+            return 0;
+        }
+    }
+    fmt::print(stderr, "usage: {} <backend>\nbackends:", argv[0]);
+    for (const auto &backend: backends) { fmt::print(stderr, " {}", backend.name); }
+    fmt::print(stderr, "\n");
+    return 1;
+}
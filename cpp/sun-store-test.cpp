@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
+
+// Writes a sun_times_store to the path given as the only argument and reads it back: every location and day has to
+// match get_sun_times_opt, and locations and days beyond the store have to be nullopt instead of reads past its end.
+// Run by ctest.
+
+#include "sun.h"
+#include <cstdio>
+#include <fmt/format.h>
+
+using date::sys_days;
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fmt::print(stderr, "usage: {} <file>\n", argv[0]);
+        return 1;
+    }
+
+    // Bielefeld, which fits 16 bit records, and Tromsø, which needs 32 bits for its polar days and nights
+    const sun::location locations[] = {{Angle::from_deg(52.02182), Angle::from_deg(8.53509)},
+                                       {Angle::from_deg(69.6492), Angle::from_deg(18.9553)}};
+    constexpr std::size_t count = std::size(locations);
+    const auto first_day = sys_days(date::January / 1 / 2023);
+    constexpr std::size_t days = 400;
+    if (!sun::write_sun_times_store(argv[1], locations, count, first_day, days)) {
+        fmt::print(stderr, "failed to write {}\n", argv[1]);
+        return 1;
+    }
+    const auto store = sun::sun_times_store::open(argv[1]);
+    std::remove(argv[1]);
+    if (!store || store->locations() != count || store->days() != days || store->first_day() != first_day) {
+        fmt::print(stderr, "failed to open {}\n", argv[1]);
+        return 1;
+    }
+
+    int failures = 0;
+    auto check = [&](bool ok, std::string_view what, std::size_t location, std::ptrdiff_t day) {
+        if (ok) return;
+        fmt::print(stderr, "location {}, day {}: {}\n", location, day, what);
+        failures++;
+    };
+    for (std::size_t l = 0; l < count; l++) {
+        const auto location = store->location_of(l);
+        check(location && location->latitude.deg() == locations[l].latitude.deg() &&
+                      location->longitude.deg() == locations[l].longitude.deg(),
+              "wrong location", l, 0);
+        for (std::size_t d = 0; d < days; d++) {
+            const auto date = first_day + date::days(d);
+            const auto times = store->get(l, date);
+            const auto expected = sun::noaa::get_sun_times_opt(locations[l].latitude, locations[l].longitude, date);
+            check(times && times->noon == expected.noon && times->midnight == expected.midnight &&
+                          times->astro_dawn == expected.astro_dawn && times->naut_dawn == expected.naut_dawn &&
+                          times->civil_dawn == expected.civil_dawn && times->sunrise == expected.sunrise &&
+                          times->sunset == expected.sunset && times->civil_dusk == expected.civil_dusk &&
+                          times->naut_dusk == expected.naut_dusk && times->astro_dusk == expected.astro_dusk,
+                  "differs from get_sun_times_opt", l, static_cast<std::ptrdiff_t>(d));
+        }
+        check(!store->get(l, first_day - date::days(1)), "day before the store", l, -1);
+        check(!store->get(l, first_day + date::days(days)), "day after the store", l, days);
+    }
+    for (auto l: {count, count + 1, std::size_t{1} << 40, ~std::size_t{0}}) {
+        check(!store->location_of(l), "location_of beyond the store", l, 0);
+        check(!store->get(l, first_day), "location beyond the store", l, 0);
+    }
+
+    if (failures) return 1;
+    fmt::print("{} locations, {} days: ok\n", count, days);
+}
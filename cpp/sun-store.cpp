@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
+
+// Precomputes a sun_times_store file, for devices that shouldn't calculate their events at runtime.
+
+#include "sun.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fmt/format.h>
+#include <optional>
+#include <vector>
+
+// The most days a store may have, about 270 years, to catch typos before they fill the disk
+static constexpr unsigned long max_days = 100000;
+
+// Returns the number in arg, or nullopt if it isn't one made of digits only or is outside of [1, max_days]
+static std::optional<std::size_t> parse_days(const char *arg) {
+    char *end;
+    errno = 0;
+    const auto res = std::strtoul(arg, &end, 10);
+    if (*arg < '0' || *arg > '9' || *end != '\0' || errno == ERANGE || res == 0 || res > max_days) return std::nullopt;
+    return res;
+}
+
+// Returns the angle in degrees in arg, or nullopt if it isn't a number or is outside of [-limit, limit]
+static std::optional<Angle> parse_angle(const char *arg, double limit) {
+    char *end;
+    const auto res = std::strtod(arg, &end);
+    if (end == arg || *end != '\0' || !(res >= -limit && res <= limit)) return std::nullopt;
+    return Angle::from_deg(res);
+}
+
+int main(int argc, char **argv) {
+    auto usage = [&] {
+        fmt::print(stderr, "usage: {} <file> <first day as YYYY-MM-DD> <days> <latitude> <longitude> [...]\n", argv[0]);
+        return 1;
+    };
+    if (argc < 6 || (argc - 4) % 2 != 0) return usage();
+
+    int y;
+    unsigned m, d;
+    if (std::sscanf(argv[2], "%d-%u-%u", &y, &m, &d) != 3 || !date::year_month_day(date::year(y) / m / d).ok()) {
+        fmt::print(stderr, "invalid date: {}\n", argv[2]);
+        return usage();
+    }
+    const auto first_day = date::sys_days(date::year(y) / m / d);
+    const auto days = parse_days(argv[3]);
+    if (!days) {
+        fmt::print(stderr, "invalid number of days: {}, expected 1 to {}\n", argv[3], max_days);
+        return usage();
+    }
+
+    std::vector<sun::location> locations;
+    for (int i = 4; i < argc; i += 2) {
+        const auto latitude = parse_angle(argv[i], 90), longitude = parse_angle(argv[i + 1], 180);
+        if (!latitude || !longitude) {
+            fmt::print(stderr, "invalid location: {} {}\n", argv[i], argv[i + 1]);
+            return usage();
+        }
+        locations.push_back({*latitude, *longitude});
+    }
+
+    if (!sun::write_sun_times_store(argv[1], locations.data(), locations.size(), first_day, *days)) {
+        fmt::print(stderr, "failed to write {}\n", argv[1]);
+        return 1;
+    }
+    fmt::print("{}: {} locations, {} days\n", argv[1], locations.size(), *days);
+}
@@ -2,9 +2,18 @@
 // SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
 
 #include "angle.h"
+#include "angle_approx.h"
+#include <array>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <date/date.h>
+#include <date/tz.h>
+#include <iterator>
+#include <limits>
 #include <optional>
+#include <utility>
+#include <vector>
 
 namespace sun {
 
@@ -28,6 +37,69 @@ namespace SunTime {
     static constexpr auto AstroDusk = Angle::from_deg(90.0 - astroTwilightElev);
 }// namespace SunTime
 
+// The events of a sun_times struct, in the order of its members.
+enum class sun_event : std::size_t {
+    noon,
+    midnight,
+    astro_dawn,
+    naut_dawn,
+    civil_dawn,
+    sunrise,
+    sunset,
+    civil_dusk,
+    naut_dusk,
+    astro_dusk,
+};
+
+static constexpr std::size_t sun_event_count = 10;
+
+// A set of sun_events as a bit mask, with bit n standing for the sun_event of value n. Events combine with |, as in
+// sun_event::sunrise | sun_event::sunset.
+using sun_event_mask = std::uint32_t;
+
+constexpr sun_event_mask mask_of(sun_event event) { return sun_event_mask{1} << static_cast<std::size_t>(event); }
+constexpr sun_event_mask operator|(sun_event lhs, sun_event rhs) { return mask_of(lhs) | mask_of(rhs); }
+constexpr sun_event_mask operator|(sun_event_mask lhs, sun_event rhs) { return lhs | mask_of(rhs); }
+
+static constexpr sun_event_mask all_sun_events = (sun_event_mask{1} << sun_event_count) - 1;
+
+// Returns the SunTime angle of an event
+constexpr Angle elevation_of(sun_event event) {
+    switch (event) {
+        case sun_event::noon: return SunTime::Noon;
+        case sun_event::midnight: return SunTime::Midnight;
+        case sun_event::astro_dawn: return SunTime::AstroDawn;
+        case sun_event::naut_dawn: return SunTime::NautDawn;
+        case sun_event::civil_dawn: return SunTime::CivilDawn;
+        case sun_event::sunrise: return SunTime::Sunrise;
+        case sun_event::sunset: return SunTime::Sunset;
+        case sun_event::civil_dusk: return SunTime::CivilDusk;
+        case sun_event::naut_dusk: return SunTime::NautDusk;
+        case sun_event::astro_dusk: return SunTime::AstroDusk;
+    }
+    return SunTime::Noon;
+}
+
+// The cosine and sine of the SunTime angle of an event
+struct elevation_trig {
+    double cos;
+    double sin;
+};
+
+constexpr elevation_trig event_trig(sun_event event) {
+    return {constexpr_cos(elevation_of(event).rad()), constexpr_sin(elevation_of(event).rad())};
+}
+
+// event_trig of every event, in the order of sun_event. Like the SunTime angles, these are constant expressions, so
+// they are in the binary as they are instead of being calculated at startup or per call, and no static initializer of
+// another translation unit can see them before they are set.
+static constexpr std::array<elevation_trig, sun_event_count> sun_event_trig = {
+        event_trig(sun_event::noon),      event_trig(sun_event::midnight),   event_trig(sun_event::astro_dawn),
+        event_trig(sun_event::naut_dawn), event_trig(sun_event::civil_dawn), event_trig(sun_event::sunrise),
+        event_trig(sun_event::sunset),    event_trig(sun_event::civil_dusk), event_trig(sun_event::naut_dusk),
+        event_trig(sun_event::astro_dusk),
+};
+
 struct sun_times {
     date::sys_seconds noon;
     date::sys_seconds midnight;
@@ -39,6 +111,235 @@ struct sun_times {
     std::optional<date::sys_seconds> civil_dusk;
     std::optional<date::sys_seconds> naut_dusk;
     std::optional<date::sys_seconds> astro_dusk;
+
+    // The events that were calculated. The others are nullopt because they weren't asked for, not because they
+    // don't happen. Noon and midnight are always calculated.
+    sun_event_mask events = all_sun_events;
+
+    [[nodiscard]] constexpr bool has(sun_event event) const { return (events & mask_of(event)) != 0; }
+};
+
+// A location on earth, as taken by the batch functions.
+struct location {
+    Angle latitude;
+    Angle longitude;
+};
+
+// The events of a sun_times in the local time of a zone, see zone_offsets::to_local.
+struct local_sun_times {
+    date::local_seconds noon;
+    date::local_seconds midnight;
+    std::optional<date::local_seconds> astro_dawn;
+    std::optional<date::local_seconds> naut_dawn;
+    std::optional<date::local_seconds> civil_dawn;
+    std::optional<date::local_seconds> sunrise;
+    std::optional<date::local_seconds> sunset;
+    std::optional<date::local_seconds> civil_dusk;
+    std::optional<date::local_seconds> naut_dusk;
+    std::optional<date::local_seconds> astro_dusk;
+
+    sun_event_mask events = all_sun_events;
+
+    [[nodiscard]] constexpr bool has(sun_event event) const { return (events & mask_of(event)) != 0; }
+};
+
+// The UTC offsets of one time zone from first_day to last_day (plus a day of margin), read from the tz database once
+// at construction. After that, finding the offset at a time point is a search through the few transitions in the
+// range instead of a call into date::tz, so one of these per zone and year is enough to convert a whole fleet of
+// locations. Time points outside of the range are looked up in the zone as usual.
+//
+// Zones are the only part of the library that uses the tz database, and date only loads it on the first
+// date::locate_zone() or date::current_zone(), which the caller does to get the zone. So processes that don't use
+// zones never load it, and those that do only pay for it when they get there.
+struct zone_offsets {
+    zone_offsets(const date::time_zone *zone, date::sys_days first_day, date::sys_days last_day);
+
+    [[nodiscard]] const date::time_zone *zone() const { return tz; }
+
+    // Returns the UTC offset of the zone at tp.
+    [[nodiscard]] std::chrono::seconds offset_at(date::sys_seconds tp) const;
+
+    // Returns the UTC date whose solar noon at longitude falls on the local date day. That is the same date, unless
+    // the zone is more than 12 hours off the solar time of the longitude, like UTC+13 and +14 in the Pacific.
+    [[nodiscard]] date::sys_days utc_date_of(date::local_days day, Angle longitude) const;
+
+    // Returns times with all events in local time. Events keep the offset at their own time, so one on a day with a
+    // DST change may have a different one than noon.
+    [[nodiscard]] local_sun_times to_local(const sun_times &times) const;
+
+private:
+    // Returns the index into starts of the offset at tp, which must be within first and last
+    [[nodiscard]] std::size_t index_of(date::sys_seconds tp) const;
+
+    const date::time_zone *tz;
+    date::sys_seconds first;
+    date::sys_seconds last;
+    // offsets[i] applies from starts[i] up to starts[i + 1], the first one from before first.
+    std::vector<date::sys_seconds> starts;
+    std::vector<std::chrono::seconds> offsets;
+};
+
+// A sun_times struct in 40 bytes, about a quarter of its size. Every event is stored as seconds since midnight UTC of
+// the date it was calculated for, which may be negative or beyond a day, and events that don't occur as none.
+// Together with that date, pack and unpack convert losslessly.
+struct packed_sun_times {
+    static constexpr std::int32_t none = std::numeric_limits<std::int32_t>::min();
+
+    [[nodiscard]] constexpr std::int32_t operator[](sun_event event) const {
+        return events[static_cast<std::size_t>(event)];
+    }
+
+    std::int32_t events[sun_event_count];
+};
+
+packed_sun_times pack(const sun_times &times, date::sys_days date);
+sun_times unpack(const packed_sun_times &packed, date::sys_days date);
+
+// Columnar storage for the sun_times of many locations over consecutive days, packed like packed_sun_times. There is
+// one column per event, and within a column, all locations of a day are stored next to each other. That way, a batch
+// calculation for one date fills one contiguous row of every column.
+struct sun_times_table {
+    sun_times_table(std::size_t locations, date::sys_days first_day, std::size_t days);
+
+    [[nodiscard]] std::size_t locations() const { return location_count; }
+    [[nodiscard]] std::size_t days() const { return day_count; }
+    [[nodiscard]] date::sys_days first_day() const { return first; }
+    [[nodiscard]] date::sys_days date_of(std::size_t day) const { return first + date::days(day); }
+    [[nodiscard]] std::size_t size_bytes() const { return data.size() * sizeof(std::int32_t); }
+
+    // Returns the locations() values of one event on one day, indexed by location.
+    [[nodiscard]] std::int32_t *row(sun_event event, std::size_t day) {
+        return data.data() + (static_cast<std::size_t>(event) * day_count + day) * location_count;
+    }
+    [[nodiscard]] const std::int32_t *row(sun_event event, std::size_t day) const {
+        return data.data() + (static_cast<std::size_t>(event) * day_count + day) * location_count;
+    }
+
+    [[nodiscard]] packed_sun_times packed(std::size_t location, std::size_t day) const;
+    [[nodiscard]] sun_times get(std::size_t location, std::size_t day) const;
+    void set(std::size_t location, std::size_t day, const sun_times &times);
+
+private:
+    std::size_t location_count;
+    std::size_t day_count;
+    date::sys_days first;
+    std::vector<std::int32_t> data;
+};
+
+// The implementations of get_sun_times, to tell apart the tables they filled.
+enum class sun_backend : std::uint32_t { noaa, wiki, redshift, rust };
+
+// Writes a table to path in the format of sun_times_file, together with the backend and the events it was filled
+// with. Returns false if the file couldn't be written.
+bool write_sun_times_file(const char *path, const sun_times_table &table, sun_backend backend, sun_event_mask events);
+
+// A file written by write_sun_times_file, mapped into memory read-only, so opening one costs the same for any size and
+// nothing gets parsed. Where there is no mmap, like on Windows, open reads the whole file into memory instead. The
+// layout is fixed, in the byte order of the writer, which open checks:
+//
+//   offset  type      content
+//        0  char[8]   "SUNTIMES"
+//        8  uint32    0x01020304, to check the byte order
+//       12  uint32    format version, 1
+//       16  uint32    sun_backend
+//       20  uint32    sun_event_mask
+//       24  int64     first day, in days since 1970-01-01
+//       32  uint64    number of locations
+//       40  uint64    number of days
+//       48  byte[16]  reserved, zero
+//       64  int32[]   the values of sun_times_table, so the value for event e, day d and location l is at index
+//                     (e * days + d) * locations + l
+struct sun_times_file {
+    // Returns nullopt if the file can't be mapped or isn't a valid sun_times_file.
+    static std::optional<sun_times_file> open(const char *path);
+
+    sun_times_file(sun_times_file &&other) noexcept;
+    sun_times_file &operator=(sun_times_file &&other) noexcept;
+    ~sun_times_file();
+
+    [[nodiscard]] sun_backend backend() const { return source; }
+    [[nodiscard]] sun_event_mask events() const { return mask; }
+    [[nodiscard]] std::size_t locations() const { return location_count; }
+    [[nodiscard]] std::size_t days() const { return day_count; }
+    [[nodiscard]] date::sys_days first_day() const { return first; }
+    [[nodiscard]] date::sys_days date_of(std::size_t day) const { return first + date::days(day); }
+
+    // Returns the locations() values of one event on one day, like sun_times_table::row.
+    [[nodiscard]] const std::int32_t *row(sun_event event, std::size_t day) const {
+        return data + (static_cast<std::size_t>(event) * day_count + day) * location_count;
+    }
+
+    [[nodiscard]] packed_sun_times packed(std::size_t location, std::size_t day) const;
+    [[nodiscard]] sun_times get(std::size_t location, std::size_t day) const;
+
+private:
+    sun_times_file() = default;
+
+    void *map = nullptr;
+    std::size_t map_size = 0;
+    const std::int32_t *data = nullptr;
+    sun_backend source = sun_backend::noaa;
+    sun_event_mask mask = 0;
+    std::size_t location_count = 0;
+    std::size_t day_count = 0;
+    date::sys_days first{};
+};
+
+// Precomputes the sun_times of some locations over days consecutive dates with noaa::get_sun_times_opt and writes them
+// to path in the format of sun_times_store. Returns false if the file couldn't be written.
+bool write_sun_times_store(const char *path, const location *locations, std::size_t count, date::sys_days first_day,
+                           std::size_t days);
+
+// A file written by write_sun_times_store, mapped into memory read-only like sun_times_file. Made for devices that
+// only need the events of a few fixed locations: a lookup is a single indexed read, with no trig and no allocation.
+//
+// Every event is delta-encoded against a base for its location, the earliest time of day it has in the file.
+// Times of day of one event change slowly over the year, so the deltas usually fit 16 bits, which halves the size of
+// packed_sun_times. Locations where some event spans more than 18 hours, like at the polar circles, are stored in
+// 32 bits like packed_sun_times instead. The layout is fixed, in the byte order of the writer, which open checks:
+//
+//   offset  type      content
+//        0  char[8]   "SUNSTORE"
+//        8  uint32    0x01020304, to check the byte order
+//       12  uint32    format version, 1
+//       16  int64     first day, in days since 1970-01-01
+//       24  uint64    number of locations
+//       32  uint64    number of days
+//       40  byte[24]  reserved, zero
+//       64  entry[]   one per location, 72 bytes each:
+//                       double   latitude in degrees
+//                       double   longitude in degrees
+//                       int32[]  base of each event, in seconds since midnight UTC
+//                       uint32   1 if the records are 32 bits wide, else 0
+//                       uint32   reserved, zero
+//                       uint64   file offset of the records of the location
+//        …  records   per location, one per day, of a value for each event: with 16 bits, the seconds since
+//                     the base of its event, or 0xffff if it doesn't happen, and with 32 bits, like packed_sun_times
+struct sun_times_store {
+    // Returns nullopt if the file can't be mapped or isn't a valid sun_times_store.
+    static std::optional<sun_times_store> open(const char *path);
+
+    sun_times_store(sun_times_store &&other) noexcept;
+    sun_times_store &operator=(sun_times_store &&other) noexcept;
+    ~sun_times_store();
+
+    [[nodiscard]] std::size_t locations() const { return location_count; }
+    [[nodiscard]] std::size_t days() const { return day_count; }
+    [[nodiscard]] date::sys_days first_day() const { return first; }
+    // Returns a location of the store, or nullopt if there are no more than location of them.
+    [[nodiscard]] std::optional<location> location_of(std::size_t location) const;
+
+    // Returns the sun_times of a location on a date, or nullopt if the location or the date isn't in the store.
+    [[nodiscard]] std::optional<sun_times> get(std::size_t location, date::sys_days date) const;
+
+private:
+    sun_times_store() = default;
+
+    void *map = nullptr;
+    std::size_t map_size = 0;
+    std::size_t location_count = 0;
+    std::size_t day_count = 0;
+    date::sys_days first{};
 };
 
 namespace wiki {
@@ -51,8 +352,10 @@ namespace wiki {
 
     // Returns a filled sun_times struct with all twilight elevation times at a given location and date.
     // Events that don't occur are nullopt. This variant may return an event that doesn't actually happen
-    // in polar circles (e.g. a last sunset right before the polar day).
-    sun_times get_sun_times(Angle latitude, Angle longitude, date::sys_days date);
+    // in polar circles (e.g. a last sunset right before the polar day). Only the events in the mask are
+    // calculated, see sun_times::events.
+    sun_times get_sun_times(Angle latitude, Angle longitude, date::sys_days date,
+                            sun_event_mask events = all_sun_events);
 }// namespace wiki
 
 namespace noaa {
@@ -61,27 +364,505 @@ namespace noaa {
     // want to depend on this rather than any concrete elevation angles. Redshift also works like this.
     Angle get_sun_elevation(Angle latitude, Angle longitude, date::sys_seconds time_point);
 
+    // Where the sun is in the sky. elevation is measured from the zenith like the SunTime angles and the result of
+    // get_sun_elevation, so 0° is straight above and 90.833° is sunrise or sunset. azimuth goes clockwise from north in
+    // [0°, 360°), with 90° east and 180° south. With the sun exactly in the zenith or nadir, azimuth is 0°.
+    struct sun_position {
+        Angle elevation;
+        Angle azimuth;
+    };
+
+    // Structure-of-arrays output for the sun_position batches. Both members point to count Angles.
+    struct sun_positions_soa {
+        Angle *elevation;
+        Angle *azimuth;
+    };
+
+    // Returns the sun_position at a given location and time, with the same elevation as get_sun_elevation. The hour
+    // angle and declination that get_sun_elevation needs anyway give the azimuth, too.
+    sun_position get_sun_position(Angle latitude, Angle longitude, date::sys_seconds time_point);
+
+    // Fills out[0..count) with the sun_positions at count time points at one location, for trackers and shading that
+    // follow the sun through the day. Time points of the same UTC day share an elevation_sampler, so the terms that
+    // only depend on the time are evaluated three times per day and the rest runs on several time points per
+    // instruction. Results are within the accuracy of elevation_sampler. Time points in order, like a series of them,
+    // are the fast case: every change of the UTC day from one time point to the next sets up a new sampler.
+    void get_sun_positions(Angle latitude, Angle longitude, const date::sys_seconds *time_points, std::size_t count,
+                           const sun_positions_soa &out);
+
+    // Fills out[0..count) with the sun_positions of count locations at one time point. The declination and equation
+    // of time only depend on the time, so they are calculated once for all locations, and each location just takes
+    // the sines and cosines of its latitude and hour angle, several locations per instruction. Results are within
+    // 1e-8° of get_sun_position.
+    void get_sun_positions(const Angle *latitude, const Angle *longitude, std::size_t count,
+                           date::sys_seconds time_point, const sun_positions_soa &out);
+
+    // Samples the solar elevation of one location over one day, for dimmers and the like that need it often. The terms
+    // that only depend on the time are evaluated three times for the whole day and interpolated in between, so every
+    // elevation takes just a cos() and an acos(). Results agree with get_sun_elevation to within 5e-5°, or 3e-3° with
+    // the sun straight above or below, where the acos() amplifies the tiny interpolation error. The azimuth of
+    // position() is within 2e-4° of get_sun_position, too, except for the last degree around the zenith and nadir.
+    // Time points outside of the day work as well, but get less accurate the further away they are.
+    struct elevation_sampler {
+        elevation_sampler(Angle latitude, Angle longitude, date::sys_days date);
+
+        [[nodiscard]] Angle elevation(date::sys_seconds time_point) const;
+
+        // The elevation as above, and the azimuth from the same interpolated terms
+        [[nodiscard]] sun_position position(date::sys_seconds time_point) const;
+
+        // Fills out[0..count) with the elevations at first, first + step, first + 2 * step and so on. This runs on
+        // several time points per instruction like get_sun_times_soa, e.g. 1440 samples for a day at one per minute.
+        void fill(date::sys_seconds first, std::chrono::seconds step, std::size_t count, Angle *out) const;
+
+        // Same with the sun_positions, at the same time points or at time_points[0..count)
+        void fill(date::sys_seconds first, std::chrono::seconds step, std::size_t count,
+                  const sun_positions_soa &out) const;
+        void fill(const date::sys_seconds *time_points, std::size_t count, const sun_positions_soa &out) const;
+
+    private:
+        // Midnight UTC in days since the epoch, then quadratics in the fraction of the day x, as c[0] + x * (c[1] + x
+        // * c[2]), with the equation of time in radians.
+        double midnight;
+        double longitude;
+        double sin_lat;
+        double cos_lat;
+        double eq_of_time[3];
+        double sin_decl[3];
+        double cos_decl[3];
+    };
+
     // Returns the time of solar elevation at a given location and date, or nullopt if that elevation
     // isn't reached there and then. You can use the predefined angles from the SunTimes namespace for
     // the usual twilight angles. This variant seems to be reliable even for polar regions.
     std::optional<date::sys_seconds> get_sun_time(Angle latitude, Angle longitude, date::sys_days date,
                                                   Angle sun_elevation);
 
+    // Returns the first time at or after from at which the sun passes the given elevation, like get_sun_time would
+    // return it, or nullopt if it never does at that latitude. Polar days and nights are skipped in one go, using the
+    // declination the elevation needs there, so this takes about as long at the poles as anywhere else.
+    std::optional<date::sys_seconds> next_crossing(Angle latitude, Angle longitude, date::sys_seconds from,
+                                                   Angle sun_elevation);
+
     // Returns a filled sun_times struct with all twilight elevation times at a given location and date.
     // Events that don't occur are nullopt. This variant seems to be reliable even for polar regions.
-    sun_times get_sun_times(Angle latitude, Angle longitude, date::sys_days date);
+    // Only the events in the mask are calculated, see sun_times::events.
+    sun_times get_sun_times(Angle latitude, Angle longitude, date::sys_days date,
+                            sun_event_mask events = all_sun_events);
 
     // Returns a filled sun_times struct with all twilight elevation times at a given location and date.
     // Events that don't occur are nullopt. Differs from get_sun_times only in being optimized to reuse
-    // some calculations and run slightly faster.
-    sun_times get_sun_times_opt(Angle latitude, Angle longitude, date::sys_days date);
+    // some calculations and run slightly faster. Only the events in the mask are calculated, see sun_times::events.
+    sun_times get_sun_times_opt(Angle latitude, Angle longitude, date::sys_days date,
+                                sun_event_mask events = all_sun_events);
+
+    // Same as get_sun_times_opt, but with the polynomial trigonometry of angle_approx.h at precision P instead of
+    // libm. From 1950 to 2090, medium precision is at most a second off get_sun_times_opt up to 70° of latitude and
+    // 34 s beyond, high precision at most a second everywhere, and neither has an event happen with only one of them.
+    // Low precision is minutes off where the sun barely reaches an elevation. A call takes about 80%, 93% and 120% of
+    // get_sun_times_opt at low, medium and high precision, libm being hard to beat for doubles. Instantiated for all
+    // three precisions.
+    template<trig_precision P = default_trig_precision>
+    sun_times get_sun_times_approx(Angle latitude, Angle longitude, date::sys_days date,
+                                   sun_event_mask events = all_sun_events);
+
+    namespace detail {
+        // What the events of the get_sun_times_opt template below are calculated from.
+        struct event_base {
+            date::sys_days date;
+            julian_date::julian_century noon;
+            Angle latitude;
+            Angle longitude;
+        };
+
+        // Sets noon and midnight in out and returns the base for the other events.
+        event_base event_base_of(Angle latitude, Angle longitude, date::sys_days date, sun_times &out);
+
+        // Instantiated in noaa_sun.cpp for all events but noon and midnight.
+        template<sun_event Event>
+        std::optional<date::sys_seconds> event_time(const event_base &base);
+
+        constexpr auto member_of(sun_event event) -> std::optional<date::sys_seconds> sun_times::* {
+            switch (event) {
+                case sun_event::astro_dawn: return &sun_times::astro_dawn;
+                case sun_event::naut_dawn: return &sun_times::naut_dawn;
+                case sun_event::civil_dawn: return &sun_times::civil_dawn;
+                case sun_event::sunrise: return &sun_times::sunrise;
+                case sun_event::sunset: return &sun_times::sunset;
+                case sun_event::civil_dusk: return &sun_times::civil_dusk;
+                case sun_event::naut_dusk: return &sun_times::naut_dusk;
+                case sun_event::astro_dusk: return &sun_times::astro_dusk;
+                default: return nullptr;
+            }
+        }
+    }// namespace detail
+
+    // Like get_sun_times_opt, but only calculates the events given as template arguments and leaves the others
+    // nullopt. Noon and midnight are always set, as the other events are calculated from noon. The elevations of the
+    // events are compile-time constants this way, e.g. get_sun_times_opt<sun_event::sunrise, sun_event::sunset>()
+    // does just the trigonometry needed for sunrise and sunset.
+    template<sun_event... Events>
+    sun_times get_sun_times_opt(Angle latitude, Angle longitude, date::sys_days date) {
+        static_assert(((detail::member_of(Events) != nullptr) && ...), "noon and midnight are always calculated");
+        sun_times res{};
+        res.events = ((sun_event::noon | sun_event::midnight) | ... | mask_of(Events));
+        const auto base = detail::event_base_of(latitude, longitude, date, res);
+        ((res.*detail::member_of(Events) = detail::event_time<Events>(base)), ...);
+        return res;
+    }
+
+    // Fills out[0..count) with the sun_times for each of the given locations at one date. The terms of the calculation
+    // that only depend on the date are prepared once for the whole batch instead of once per location, which makes
+    // this a lot faster than calling get_sun_times_opt in a loop. Results match get_sun_times_opt, give or take a
+    // second of rounding. Only on days where the sun merely grazes an elevation (like the last sunset before a polar
+    // night) the two may disagree on whether the event happens. Only the events in the mask are calculated.
+    void get_sun_times_batch(const location *locations, std::size_t count, date::sys_days date, sun_times *out,
+                             sun_event_mask events = all_sun_events);
+
+    // Same as above, but for all table.locations() locations on table.date_of(day), written straight into the table.
+    void get_sun_times_batch(const location *locations, sun_times_table &table, std::size_t day);
+
+    // Precomputed equation of time and sun declination for a range of dates, with samples_per_day samples per day and
+    // cubic interpolation in between. Both only depend on the time and change so slowly that event times stay within
+    // the second they'd be in otherwise, even with one sample per day. 1950 to 2100 at the default rate take 3.5 MB.
+    // Time points outside of first_day to last_day (plus a day of margin) are calculated exactly instead.
+    struct daily_ephemeris {
+        daily_ephemeris(date::sys_days first_day, date::sys_days last_day, unsigned samples_per_day = 4);
+
+        [[nodiscard]] std::size_t size_bytes() const { return samples.size() * sizeof(sample); }
+
+        [[nodiscard]] Angle equation_of_time(julian_date::julian_century tp) const;
+        [[nodiscard]] Angle sun_declination(julian_date::julian_century tp) const;
+
+    private:
+        struct sample {
+            double eq_of_time;
+            double declination;
+        };
+
+        [[nodiscard]] const sample *find(julian_date::julian_century tp, double &fraction) const;
+
+        julian_date::julian_century start;
+        double samples_per_century;
+        std::vector<sample> samples;
+    };
+
+    // Same as get_sun_times_opt and get_sun_times_batch, but using the precomputed ephemeris instead of evaluating the
+    // date dependent terms of the calculation.
+    sun_times get_sun_times_opt(Angle latitude, Angle longitude, date::sys_days date,
+                                const daily_ephemeris &ephemeris);
+    void get_sun_times_batch(const location *locations, std::size_t count, date::sys_days date, sun_times *out,
+                             const daily_ephemeris &ephemeris);
+
+    // Fills out[0..days) with the sun_times of one location for days consecutive dates from first_day on. Every day
+    // starts from the results of the day before, so a single pass of the calculation is enough for most events.
+    // Events that change too fast for that, like around the start and end of polar days and nights, take the full
+    // path of get_sun_times_opt. Results match get_sun_times_opt, give or take a second of rounding.
+    void get_sun_times_range(Angle latitude, Angle longitude, date::sys_days first_day, std::size_t days,
+                             sun_times *out);
+
+    // The range of the sun's declination at noon for each day from first_day to last_day, to tell up front which
+    // events can't happen at a latitude on a day: those of an elevation the sun doesn't reach with any of these
+    // declinations, as in polar days and nights. get_sun_times_batch and get_sun_times_range skip those events
+    // instead of finding out through the whole calculation, with the same results. A year takes 6 kB.
+    struct polar_table {
+        polar_table(date::sys_days first_day, date::sys_days last_day);
+
+        // Returns the events that can't happen on date at latitude, at any longitude from -180° to 180°, or 0 for
+        // dates out of range. Other events may still not happen on that day.
+        [[nodiscard]] sun_event_mask impossible(Angle latitude, date::sys_days date) const;
+
+    private:
+        date::sys_days first;
+        // The lowest and highest declination of each day in degrees, with some margin
+        std::vector<std::pair<double, double>> declinations;
+    };
+
+    // Same as above, with a polar table covering the range, e.g. to share one between the locations of a fleet.
+    // get_sun_times_range otherwise builds its own one for locations far enough from the equator to need it.
+    void get_sun_times_range(Angle latitude, Angle longitude, date::sys_days first_day, std::size_t days,
+                             sun_times *out, const polar_table &polar);
+
+    // One event of an event_stream.
+    struct timed_event {
+        sun_event event;
+        date::sys_seconds time;
+    };
+
+    // The events of one location from a time point on, without end, in time order. Days are calculated with
+    // get_sun_times_opt only as their events are read, and at most two of them are held at a time, so reading a
+    // century takes no more memory than reading a day. Only the events in the mask are returned, and events at the
+    // same second come in the order of sun_event. Can be read with next() or a range-for loop, which has to break
+    // out on its own.
+    struct event_stream {
+        event_stream(Angle latitude, Angle longitude, date::sys_seconds from, sun_event_mask events = all_sun_events);
+
+        // Returns the next event, or nullopt if none of the mask happens for two years on end, like an elevation the
+        // sun never reaches at that latitude. Every call after that returns nullopt as well.
+        std::optional<timed_event> next();
+
+        // An input iterator over next(), which equals end() once next() returns nullopt.
+        struct iterator {
+            using iterator_category = std::input_iterator_tag;
+            using value_type = timed_event;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const timed_event *;
+            using reference = const timed_event &;
+
+            reference operator*() const { return *current; }
+            pointer operator->() const { return &*current; }
+            iterator &operator++() {
+                current = stream->next();
+                return *this;
+            }
+            bool operator==(const iterator &other) const { return !current && !other.current; }
+            bool operator!=(const iterator &other) const { return !(*this == other); }
+
+        private:
+            friend struct event_stream;
+            iterator() = default;
+            explicit iterator(event_stream *stream) : stream(stream), current(stream->next()) {}
+
+            event_stream *stream = nullptr;
+            std::optional<timed_event> current;
+        };
+
+        iterator begin() { return iterator(this); }
+        iterator end() { return {}; }
+
+    private:
+        // Calculates the next day and adds its events from from on to pending
+        void read_day();
+
+        Angle latitude;
+        Angle longitude;
+        date::sys_seconds from;
+        sun_event_mask mask;
+        date::sys_days next_date;
+        // No event of next_date or later comes before this
+        date::sys_seconds bound = date::sys_seconds::min();
+        int idle_days = 0;
+        // The events read but not returned yet, latest first. Those of the day before next_date that aren't before
+        // bound are only its last one or two, so the events of two days always fit.
+        std::array<timed_event, 2 * sun_event_count> pending{};
+        std::size_t count = 0;
+    };
+
+    // One event of an event_schedule, at the location of index site.
+    struct site_event {
+        std::size_t site;
+        sun_event event;
+        date::sys_seconds time;
+    };
+
+    // The events of many locations merged into one stream in time order, for controllers acting on whatever comes
+    // next at any of them. Keeps an event_stream per location and a heap of their next events, so taking one costs
+    // O(log n) in the locations, plus a day of get_sun_times_opt whenever a location runs out of pending events.
+    // Events at the same second come in the order of the locations, then of sun_event.
+    struct event_schedule {
+        event_schedule(const location *locations, std::size_t count, date::sys_seconds from,
+                       sun_event_mask events = all_sun_events);
+
+        [[nodiscard]] std::size_t sites() const { return streams.size(); }
+
+        // Returns the next event without taking it, or nullopt if no location has any left, see event_stream::next.
+        [[nodiscard]] std::optional<site_event> peek() const;
+
+        // Takes and returns the next event, or nullopt if no location has any left.
+        std::optional<site_event> pop();
+
+        // Takes all events before until and appends them to out in time order. Returns how many there were.
+        std::size_t pop_until(date::sys_seconds until, std::vector<site_event> &out);
+
+    private:
+        // Replaces the first event of the heap with the next one of its location and restores the heap
+        void advance();
+
+        std::vector<event_stream> streams;
+        // The next event of every location that has any left, as a binary min-heap
+        std::vector<site_event> heap;
+    };
+
+    // Returns the sun_times of the local date day in the zone of zone, in local time, calculated by
+    // get_sun_times_opt for zone.utc_date_of(day, longitude). Needs no lookups in the tz database as long as the
+    // events are in the range of zone.
+    local_sun_times get_local_sun_times(Angle latitude, Angle longitude, date::local_days day, const zone_offsets &zone,
+                                        sun_event_mask events = all_sun_events);
+
+    // Fills out[0..count) with the local sun_times of each of the given locations, which all have to be in the zone of
+    // zone, like get_local_sun_times. The locations are calculated by get_sun_times_batch, with one batch per UTC date
+    // they map to, which is one for all zones but those more than 12 hours off their solar time.
+    void get_local_sun_times_batch(const location *locations, std::size_t count, date::local_days day,
+                                   const zone_offsets &zone, local_sun_times *out,
+                                   sun_event_mask events = all_sun_events);
+
+    // Structure-of-arrays output for get_sun_times_soa. Every member points to an array of at least count doubles,
+    // which receive the event times in seconds since the unix epoch. Events that don't occur are NaN.
+    struct sun_times_soa {
+        double *noon;
+        double *midnight;
+        double *astro_dawn;
+        double *naut_dawn;
+        double *civil_dawn;
+        double *sunrise;
+        double *sunset;
+        double *civil_dusk;
+        double *naut_dusk;
+        double *astro_dusk;
+    };
+
+    // Returns the number of locations get_sun_times_soa processes at once on this CPU: 8 with AVX-512, 4 with AVX2,
+    // 2 with SSE2 or NEON and 1 on anything else. With AngleF, it is twice that where there are vector registers.
+    unsigned simd_lanes();
+
+    // Like get_sun_times_batch, but with latitudes and longitudes in separate arrays and the results in
+    // structure-of-arrays form, which lets the calculation run on several locations per instruction. lanes selects
+    // the block width, 0 means simd_lanes(), and larger values than that are clamped to it. Results are the same as
+    // those of get_sun_times_batch.
+    //
+    // With AngleF latitudes and longitudes, the whole calculation runs in float, with twice the locations per
+    // instruction and half the memory for the input. Only the terms that depend on the date alone are still done in
+    // double, once per call, so the float part only sees offsets from the middle of that day. Between 1900 and 2100,
+    // events are at most 3 seconds off the double results up to 60° of latitude and 7 seconds up to 70°, and 99.7%
+    // of them are the same. Beyond that, events close to the start and end of polar days and nights, where the sun
+    // barely crosses their elevation, can be minutes off or missing on one side. Only instantiated for Angle and
+    // AngleF.
+    template<class T>
+    void get_sun_times_soa(const basic_angle<T> *latitude, const basic_angle<T> *longitude, std::size_t count,
+                           date::sys_days date, const sun_times_soa &out, unsigned lanes = 0);
+
+    // Same as above, but for all table.locations() locations on table.date_of(day), written straight into the table.
+    template<class T>
+    void get_sun_times_soa(const basic_angle<T> *latitude, const basic_angle<T> *longitude, sun_times_table &table,
+                           std::size_t day, unsigned lanes = 0);
+
+    // Same as above, but only for the count locations starting at index first, leaving the rest of the row untouched.
+    template<class T>
+    void get_sun_times_soa(const basic_angle<T> *latitude, const basic_angle<T> *longitude, std::size_t first,
+                           std::size_t count, sun_times_table &table, std::size_t day, unsigned lanes = 0);
+
+    // Fills the whole table with the sun_times of all table.locations() locations for all of its days, using up to
+    // threads threads (0 means one per hardware thread). The grid is cut into blocks of locations on one day, and
+    // threads that run out of blocks steal them from the others, so uneven progress doesn't leave cores idle. Every
+    // table entry is written by exactly one thread, without locking. Results are the same as get_sun_times_soa.
+    // Grids of more than 2^32 - 1 blocks are done in several passes, one after the other.
+    void get_sun_times_grid(const Angle *latitude, const Angle *longitude, sun_times_table &table,
+                            unsigned threads = 0);
+
+    // A memo of the time of solar noon per date and longitude, which get_sun_time, get_sun_times and
+    // get_sun_times_opt look up while one is installed with use_noon_memo. Noon takes two evaluations of the equation
+    // of time, which are saved for servers asking for the same locations on the same few dates from many threads.
+    // Keys are the exact longitude, so results stay the same as without the memo.
+    //
+    // The memo is a fixed array of sets of two entries, so memory is bounded by the capacity given at construction.
+    // Every entry is guarded by a sequence counter: readers never wait, and a writer that finds an entry being written
+    // by another thread just skips storing its result. Entries remember whether they were read since they were
+    // stored, and a new result replaces one that wasn't, so noons that are asked for again and again stay.
+    struct noon_memo {
+        // capacity is rounded up to a power of two, of at least two entries.
+        explicit noon_memo(std::size_t capacity = 4096);
+        ~noon_memo();
+
+        // Returns the time of noon as days since midnight UTC of date, if it's in the memo.
+        [[nodiscard]] std::optional<double> find(date::sys_days date, Angle longitude) const;
+        void insert(date::sys_days date, Angle longitude, double noon);
+
+        [[nodiscard]] std::size_t capacity() const;
+        [[nodiscard]] std::uint64_t hits() const;
+        [[nodiscard]] std::uint64_t misses() const;
+
+    private:
+        struct set;
+        struct counter;
+
+        std::vector<set> sets;
+        mutable std::vector<counter> counters;
+    };
+
+    // Installs memo for use by the functions above, or uninstalls it with nullptr. The memo has to outlive its use.
+    void use_noon_memo(noon_memo *memo);
+
+    // A cache in front of get_sun_times_opt for many locations close to each other. Locations are snapped to the
+    // center of a cell of a grid with cell_size degrees in latitude and longitude, and the results of each cell and
+    // date are kept, so all locations in a cell share them. The cache is split into shards with a lock each, so it can
+    // be used from many threads at once.
+    //
+    // Snapping moves a location by up to half a cell. Events move by 240 s per degree of longitude, and by the change
+    // of their hour angle with latitude, which is largest where an event barely happens at all. error_bound tells the
+    // worst case for a range of latitudes, to choose a cell size.
+    //
+    // Nothing is ever evicted: every cell and date that is looked up takes about 80 bytes until clear(), which is the
+    // only way to bound the memory of the cache, e.g. by calling it once the dates that are asked for move on.
+    struct sun_times_cache {
+        // The smallest cell size, about 10 cm. Smaller ones, zero, negative ones and NaN are taken as this one.
+        static constexpr Angle min_cell_size = Angle::from_deg(1e-6);
+
+        explicit sun_times_cache(Angle cell_size, std::size_t shards = 16);
+        ~sun_times_cache();
+
+        // Returns the sun_times of the cell of the location on date, calculating them on a miss.
+        sun_times get(Angle latitude, Angle longitude, date::sys_days date);
+
+        // Fills out[0..count) with the sun_times of the cells of count locations on date, like get for each of them.
+        // All cells that miss are calculated together by get_sun_times_soa, several per instruction, so their events
+        // may be a second off those get calculates with get_sun_times_opt (see get_sun_times_batch), and whichever of
+        // the two misses a cell first decides its results. Locations in the same cell are calculated once and count as
+        // hits after the first.
+        void get(const location *locations, std::size_t count, date::sys_days date, sun_times *out);
+
+        // Returns the sun_times of the cell of the location on date if they are cached, without calculating them on a
+        // miss. Only hits are counted, since the caller goes on to get them.
+        std::optional<sun_times> find(Angle latitude, Angle longitude, date::sys_days date);
+
+        // Returns the center of the cell of a location, which the results of all locations in it are calculated for.
+        [[nodiscard]] location cell_of(Angle latitude, Angle longitude) const;
+
+        // Returns the most seconds an event of the mask may differ from get_sun_times_opt for any location up to
+        // max_latitude north or south, on any date. Derived from hour angles on a fine grid of latitudes and
+        // declinations, plus a second for the rounding and a second for the cells the batch get filled in with
+        // get_sun_times_soa. It bounds the events that happen at both the location and the center of its cell. On the
+        // days an event starts or stops happening, it may do so at just one of them.
+        [[nodiscard]] double error_bound(Angle max_latitude, sun_event_mask events = all_sun_events) const;
+
+        [[nodiscard]] Angle cell_size() const { return cell; }
+        [[nodiscard]] std::uint64_t hits() const;
+        [[nodiscard]] std::uint64_t misses() const;
+        [[nodiscard]] std::size_t size() const;
+        // Drops all cached results and resets the hit and miss counters.
+        void clear();
+
+    private:
+        struct shard;
+
+        Angle cell;
+        std::vector<shard> shards;
+    };
 }// namespace noaa
 
 // Returns a filled sun_times struct with all twilight elevation times at a given location and date.
-// Events that don't occur are nullopt. This variant calls the solar code from redshift.
-sun_times get_sun_times_c(Angle latitude, Angle longitude, date::sys_days date);
+// Events that don't occur are nullopt. This variant calls solar_table_fill of the redshift wrapper, which in turn
+// calls the kernel of noaa_core.h. Only the events in the mask are calculated, see sun_times::events.
+sun_times get_sun_times_c(Angle latitude, Angle longitude, date::sys_days date, sun_event_mask events = all_sun_events);
+
+// Fills out[0..count) with the sun_times for each of the given locations at one date, with the redshift wrapper as
+// well, through solar_table_fill_batch. Results are the same as from get_sun_times_c for each location.
+void get_sun_times_c(const location *locations, std::size_t count, date::sys_days date, sun_times *out,
+                     sun_event_mask events = all_sun_events);
+
+// Returns a filled sun_times struct with all twilight elevation times at a given location and date.
+// Events that don't occur are nullopt. This variant calls the freestanding C code of noaa_core.h, see there for how
+// close it gets to noaa::get_sun_times_opt. Only the events in the mask are calculated, see sun_times::events.
+sun_times get_sun_times_core(Angle latitude, Angle longitude, date::sys_days date,
+                             sun_event_mask events = all_sun_events);
+
+// Fills out[0..count) with the sun_times for each of the given locations at one date, in one noaa_core_sun_times_batch
+// call per chunk of locations. Results are the same as from get_sun_times_core for each location.
+void get_sun_times_core(const location *locations, std::size_t count, date::sys_days date, sun_times *out,
+                        sun_event_mask events = all_sun_events);
 
 // Returns a filled sun_times struct with all twilight elevation times at a given location and date.
-// Events that don't occur are nullopt. This variant calls the NOAA rust implementation.
-sun_times get_sun_times_rust(Angle latitude, Angle longitude, date::sys_days date);
+// Events that don't occur are nullopt. This variant calls the Rust crate, which is an adapter over the kernel of
+// noaa_core.h as well. Only the events in the mask are calculated, see sun_times::events.
+sun_times get_sun_times_rust(Angle latitude, Angle longitude, date::sys_days date,
+                             sun_event_mask events = all_sun_events);
 }// namespace sun
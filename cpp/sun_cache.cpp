@@ -0,0 +1,255 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
+
+#include "sun.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+    struct cell_key {
+        std::int32_t latitude;
+        std::int32_t longitude;
+        std::int32_t day;
+
+        bool operator==(const cell_key &other) const {
+            return latitude == other.latitude && longitude == other.longitude && day == other.day;
+        }
+    };
+
+    struct cell_hash {
+        std::size_t operator()(const cell_key &key) const {
+            // Neighbouring cells on neighbouring days differ in the low bits of each part, so mix them all over
+            auto h = static_cast<std::uint64_t>(static_cast<std::uint32_t>(key.latitude)) << 32 |
+                     static_cast<std::uint32_t>(key.longitude);
+            h ^= static_cast<std::uint64_t>(static_cast<std::uint32_t>(key.day)) * 0x9e3779b97f4a7c15;
+            h ^= h >> 29;
+            h *= 0xbf58476d1ce4e5b9;
+            return static_cast<std::size_t>(h ^ h >> 32);
+        }
+    };
+}// namespace
+
+struct sun::noaa::sun_times_cache::shard {
+    mutable std::mutex lock;
+    std::unordered_map<cell_key, packed_sun_times, cell_hash> entries;
+    std::atomic<std::uint64_t> hits{0};
+    std::atomic<std::uint64_t> misses{0};
+};
+
+sun::noaa::sun_times_cache::sun_times_cache(Angle cell_size, std::size_t shards)
+    : cell(cell_size.deg() >= min_cell_size.deg() ? cell_size : min_cell_size),
+      shards(std::max<std::size_t>(shards, 1)) {}
+
+sun::noaa::sun_times_cache::~sun_times_cache() = default;
+
+// Returns the index of the cell a coordinate of degrees / size is in. The cast is undefined beyond the range of
+// int32_t, which coordinates only get to if they are far off the earth or NaN, so those share the cells at its ends
+// or 0.
+static std::int32_t index_of(double degrees_per_size) {
+    const auto index = std::floor(degrees_per_size);
+    if (std::isnan(index)) return 0;
+    return static_cast<std::int32_t>(std::clamp<double>(index, std::numeric_limits<std::int32_t>::min(),
+                                                        std::numeric_limits<std::int32_t>::max()));
+}
+
+// Returns the cell of a location on a date, of a grid with cells of size degrees
+static cell_key key_of(double size, Angle latitude, Angle longitude, date::sys_days date) {
+    return {index_of(latitude.deg() / size), index_of(longitude.deg() / size),
+            static_cast<std::int32_t>(date.time_since_epoch().count())};
+}
+
+// Returns the center of a cell, of a grid with cells of size degrees
+static sun::location center_of(double size, const cell_key &key) {
+    return {Angle::from_deg(std::clamp((key.latitude + 0.5) * size, -90.0, 90.0)),
+            Angle::from_deg((key.longitude + 0.5) * size)};
+}
+
+// Fills out[0..count) with the sun_times of the centers of count cells on date, of a grid with cells of size degrees,
+// calculated together by get_sun_times_soa for the batch get.
+static void calculate(double size, const cell_key *keys, std::size_t count, date::sys_days date,
+                      sun::sun_times *out) {
+    std::vector<Angle> latitudes, longitudes;
+    latitudes.reserve(count);
+    longitudes.reserve(count);
+    for (std::size_t c = 0; c < count; c++) {
+        const auto center = center_of(size, keys[c]);
+        latitudes.push_back(center.latitude);
+        longitudes.push_back(center.longitude);
+    }
+    std::vector<double> buf(sun::sun_event_count * count);
+    auto column = [&](std::size_t e) { return buf.data() + e * count; };
+    const auto columns = sun::noaa::sun_times_soa{column(0), column(1), column(2), column(3), column(4),
+                                                  column(5), column(6), column(7), column(8), column(9)};
+    sun::noaa::get_sun_times_soa(latitudes.data(), longitudes.data(), count, date, columns);
+
+    auto seconds = [](double s) { return date::sys_seconds(std::chrono::seconds(static_cast<std::int64_t>(s))); };
+    for (std::size_t c = 0; c < count; c++) {
+        out[c] = {};
+        out[c].noon = seconds(column(0)[c]);
+        out[c].midnight = seconds(column(1)[c]);
+        for (auto e = static_cast<std::size_t>(sun::sun_event::astro_dawn); e < sun::sun_event_count; e++) {
+            const auto s = column(e)[c];
+            if (s == s) out[c].*sun::noaa::detail::member_of(static_cast<sun::sun_event>(e)) = seconds(s);
+        }
+    }
+}
+
+auto sun::noaa::sun_times_cache::get(Angle latitude, Angle longitude, date::sys_days date) -> sun_times {
+    const auto key = key_of(cell.deg(), latitude, longitude, date);
+    auto &s = shards[cell_hash{}(key) % shards.size()];
+    {
+        std::lock_guard<std::mutex> guard(s.lock);
+        if (auto it = s.entries.find(key); it != s.entries.end()) {
+            s.hits.fetch_add(1, std::memory_order_relaxed);
+            return unpack(it->second, date);
+        }
+    }
+    s.misses.fetch_add(1, std::memory_order_relaxed);
+
+    // Calculated without holding the lock. If another thread misses the same cell meanwhile, both get the same result.
+    const auto center = center_of(cell.deg(), key);
+    const auto times = get_sun_times_opt(center.latitude, center.longitude, date);
+    std::lock_guard<std::mutex> guard(s.lock);
+    s.entries.emplace(key, pack(times, date));
+    return times;
+}
+
+void sun::noaa::sun_times_cache::get(const location *locations, std::size_t count, date::sys_days date,
+                                     sun_times *out) {
+    // The cells that missed, in order of their first location, and for every location the index of its cell in there
+    // or npos if it hit
+    constexpr auto npos = std::numeric_limits<std::size_t>::max();
+    std::vector<cell_key> missed;
+    std::vector<std::size_t> cell_of_location(count, npos);
+    std::unordered_map<cell_key, std::size_t, cell_hash> index;
+    for (std::size_t i = 0; i < count; i++) {
+        const auto key = key_of(cell.deg(), locations[i].latitude, locations[i].longitude, date);
+        auto &s = shards[cell_hash{}(key) % shards.size()];
+        if (auto it = index.find(key); it != index.end()) {
+            cell_of_location[i] = it->second;
+            s.hits.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        std::lock_guard<std::mutex> guard(s.lock);
+        if (auto it = s.entries.find(key); it != s.entries.end()) {
+            s.hits.fetch_add(1, std::memory_order_relaxed);
+            out[i] = unpack(it->second, date);
+        } else {
+            s.misses.fetch_add(1, std::memory_order_relaxed);
+            cell_of_location[i] = index.emplace(key, missed.size()).first->second;
+            missed.push_back(key);
+        }
+    }
+    if (missed.empty()) return;
+
+    std::vector<sun_times> times(missed.size());
+    calculate(cell.deg(), missed.data(), missed.size(), date, times.data());
+    for (std::size_t c = 0; c < missed.size(); c++) {
+        auto &s = shards[cell_hash{}(missed[c]) % shards.size()];
+        std::lock_guard<std::mutex> guard(s.lock);
+        s.entries.emplace(missed[c], pack(times[c], date));
+    }
+    for (std::size_t i = 0; i < count; i++) {
+        if (cell_of_location[i] != npos) out[i] = times[cell_of_location[i]];
+    }
+}
+
+auto sun::noaa::sun_times_cache::find(Angle latitude, Angle longitude, date::sys_days date)
+        -> std::optional<sun_times> {
+    const auto key = key_of(cell.deg(), latitude, longitude, date);
+    auto &s = shards[cell_hash{}(key) % shards.size()];
+    std::lock_guard<std::mutex> guard(s.lock);
+    if (auto it = s.entries.find(key); it != s.entries.end()) {
+        s.hits.fetch_add(1, std::memory_order_relaxed);
+        return unpack(it->second, date);
+    }
+    return std::nullopt;
+}
+
+auto sun::noaa::sun_times_cache::cell_of(Angle latitude, Angle longitude) const -> location {
+    return center_of(cell.deg(), key_of(cell.deg(), latitude, longitude, date::sys_days{}));
+}
+
+auto sun::noaa::sun_times_cache::error_bound(Angle max_latitude, sun_event_mask events) const -> double {
+    const struct {
+        sun_event dawn, dusk;
+        Angle elevation;
+    } twilights[] = {
+            {sun_event::astro_dawn, sun_event::astro_dusk, SunTime::AstroDawn},
+            {sun_event::naut_dawn, sun_event::naut_dusk, SunTime::NautDawn},
+            {sun_event::civil_dawn, sun_event::civil_dusk, SunTime::CivilDawn},
+            {sun_event::sunrise, sun_event::sunset, SunTime::Sunrise},
+    };
+
+    // Dawn and dusk of the same elevation are symmetric around noon, and the southern hemisphere mirrors the northern
+    // one on the opposite declination. So it's enough to look at positive latitudes and one of each pair.
+    //
+    // An event has the hour angle acos(c), with c = cos(zenith) / (cos(lat) * cos(decl)) - tan(lat) * tan(decl). For
+    // every patch of step x step degrees of latitude and declination, we take the range of c within it from its
+    // derivatives, and the most c changes by half a cell of latitude, dc. Then the largest change of acos() by dc
+    // within that range bounds the change of the hour angle. That is the steepest right at ±1, where the event barely
+    // happens, so we look there if the range gets close to it.
+    constexpr auto step = 0.25 * (M_PI / 180.0), max_declination = 23.44 * (M_PI / 180.0);
+    const auto half_cell = cell.rad() / 2;
+    const auto max_lat = std::min(std::abs(max_latitude.rad()) + half_cell, M_PI / 2 - step);
+    auto max_delta = 0.0;
+    for (const auto &twilight: twilights) {
+        if (!(events & (twilight.dawn | twilight.dusk))) continue;
+        const auto k = cos(twilight.elevation);
+        for (auto lat = 0.0; lat <= max_lat; lat += step) {
+            for (auto decl = -max_declination; decl <= max_declination; decl += step) {
+                const auto sec_lat = 1 / std::cos(lat), sec_decl = 1 / std::cos(decl);
+                const auto tan_lat = std::tan(lat), tan_decl = std::tan(decl);
+                const auto c = k * sec_lat * sec_decl - tan_lat * tan_decl;
+                const auto dc_dlat = std::abs(k * sec_lat * tan_lat * sec_decl - sec_lat * sec_lat * tan_decl);
+                const auto dc_ddecl = std::abs(k * sec_lat * sec_decl * tan_decl - tan_lat * sec_decl * sec_decl);
+                const auto dc = dc_dlat * half_cell;
+                const auto spread = (dc_dlat + dc_ddecl) * (step / 2);
+                const auto low = std::max(c - spread, -1.0), high = std::min(c + spread, 1.0);
+                if (low > high) continue;
+
+                for (auto x: {low, high, std::clamp(1 - dc, low, high), std::clamp(-1 + dc, low, high)}) {
+                    max_delta = std::max({max_delta, std::acos(std::max(x - dc, -1.0)) - std::acos(x),
+                                          std::acos(x) - std::acos(std::min(x + dc, 1.0))});
+                }
+            }
+        }
+    }
+    // Both latitude and longitude are off by up to half a cell, both results are rounded down to seconds and the
+    // cached one may come from get_sun_times_soa, if the batch get filled it in
+    return 240.0 * (cell.deg() / 2 + max_delta * (180.0 / M_PI)) + 2.0;
+}
+
+auto sun::noaa::sun_times_cache::hits() const -> std::uint64_t {
+    std::uint64_t res = 0;
+    for (auto &s: shards) { res += s.hits.load(std::memory_order_relaxed); }
+    return res;
+}
+
+auto sun::noaa::sun_times_cache::misses() const -> std::uint64_t {
+    std::uint64_t res = 0;
+    for (auto &s: shards) { res += s.misses.load(std::memory_order_relaxed); }
+    return res;
+}
+
+auto sun::noaa::sun_times_cache::size() const -> std::size_t {
+    std::size_t res = 0;
+    for (auto &s: shards) {
+        std::lock_guard<std::mutex> guard(s.lock);
+        res += s.entries.size();
+    }
+    return res;
+}
+
+void sun::noaa::sun_times_cache::clear() {
+    for (auto &s: shards) {
+        std::lock_guard<std::mutex> guard(s.lock);
+        s.entries.clear();
+        s.hits.store(0, std::memory_order_relaxed);
+        s.misses.store(0, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,328 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
+
+// The fixed-layout file formats for sun_times, see sun_times_file and sun_times_store in sun.h.
+
+#include "sun.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+#ifdef SUN_HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    struct file_header {
+        char magic[8];
+        std::uint32_t byte_order;
+        std::uint32_t version;
+        std::uint32_t backend;
+        std::uint32_t events;
+        std::int64_t first_day;
+        std::uint64_t locations;
+        std::uint64_t days;
+        std::uint8_t reserved[16];
+    };
+    static_assert(sizeof(file_header) == 64, "The header is part of the file format");
+
+    struct store_header {
+        char magic[8];
+        std::uint32_t byte_order;
+        std::uint32_t version;
+        std::int64_t first_day;
+        std::uint64_t locations;
+        std::uint64_t days;
+        std::uint8_t reserved[24];
+    };
+    static_assert(sizeof(store_header) == 64, "The header is part of the file format");
+
+    struct store_entry {
+        double latitude;
+        double longitude;
+        std::int32_t base[sun::sun_event_count];
+        std::uint32_t wide;
+        std::uint32_t reserved;
+        std::uint64_t offset;
+    };
+    static_assert(sizeof(store_entry) == 72, "The entries are part of the file format");
+}// namespace
+
+static constexpr char magic[8] = {'S', 'U', 'N', 'T', 'I', 'M', 'E', 'S'};
+static constexpr char store_magic[8] = {'S', 'U', 'N', 'S', 'T', 'O', 'R', 'E'};
+static constexpr std::uint32_t byte_order = 0x01020304;
+static constexpr std::uint32_t version = 1;
+
+// The largest delta of a 16 bit store record, below the value for events that don't happen
+static constexpr std::uint16_t store_none = 0xffff;
+static constexpr std::int64_t max_narrow_delta = store_none - 1;
+
+// Maps a whole file read-only, or reads it into memory where there is no mmap. Returns nullptr if that fails or the
+// file is too short for a header.
+static auto map_file(const char *path) -> std::pair<void *, std::size_t> {
+#ifdef SUN_HAVE_MMAP
+    auto fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return {nullptr, 0};
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(file_header))) {
+        ::close(fd);
+        return {nullptr, 0};
+    }
+    const auto size = static_cast<std::size_t>(st.st_size);
+    auto map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping keeps the file open by itself
+    ::close(fd);
+    if (map == MAP_FAILED) return {nullptr, 0};
+    return {map, size};
+#else
+    auto file = std::fopen(path, "rb");
+    if (!file) return {nullptr, 0};
+    const auto end = std::fseek(file, 0, SEEK_END) == 0 ? std::ftell(file) : -1L;
+    if (end < static_cast<long>(sizeof(file_header)) || std::fseek(file, 0, SEEK_SET) != 0) {
+        std::fclose(file);
+        return {nullptr, 0};
+    }
+    const auto size = static_cast<std::size_t>(end);
+    auto map = std::malloc(size);
+    const auto ok = map && std::fread(map, 1, size, file) == size;
+    std::fclose(file);
+    if (!ok) {
+        std::free(map);
+        return {nullptr, 0};
+    }
+    return {map, size};
+#endif
+}
+
+// Releases a file of map_file
+static void unmap_file(void *map, std::size_t size) {
+#ifdef SUN_HAVE_MMAP
+    munmap(map, size);
+#else
+    (void) size;
+    std::free(map);
+#endif
+}
+
+bool sun::write_sun_times_file(const char *path, const sun_times_table &table, sun_backend backend,
+                               sun_event_mask events) {
+    file_header header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.byte_order = byte_order;
+    header.version = version;
+    header.backend = static_cast<std::uint32_t>(backend);
+    header.events = events;
+    header.first_day = table.first_day().time_since_epoch().count();
+    header.locations = table.locations();
+    header.days = table.days();
+
+    auto file = std::fopen(path, "wb");
+    if (!file) return false;
+    // All values of the table are one block, starting with the first row of the first event
+    auto ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    if (ok && table.size_bytes()) ok = std::fwrite(table.row(sun_event::noon, 0), table.size_bytes(), 1, file) == 1;
+    return std::fclose(file) == 0 && ok;
+}
+
+auto sun::sun_times_file::open(const char *path) -> std::optional<sun_times_file> {
+    const auto [map, size] = map_file(path);
+    if (!map) return std::nullopt;
+
+    // From here on, res unmaps the file if it's invalid
+    sun_times_file res;
+    res.map = map;
+    res.map_size = size;
+
+    file_header header{};
+    std::memcpy(&header, map, sizeof(header));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.byte_order != byte_order ||
+        header.version != version)
+        return std::nullopt;
+
+    // Checked one at a time first, so the product can't overflow
+    const auto values = (size - sizeof(header)) / sizeof(std::int32_t);
+    if (header.locations > values || header.days > values ||
+        (header.locations && header.days > values / header.locations / sun_event_count) ||
+        sizeof(header) + header.locations * header.days * sun_event_count * sizeof(std::int32_t) != size)
+        return std::nullopt;
+
+    res.data = reinterpret_cast<const std::int32_t *>(static_cast<const char *>(map) + sizeof(header));
+    res.source = static_cast<sun_backend>(header.backend);
+    res.mask = header.events;
+    res.location_count = header.locations;
+    res.day_count = header.days;
+    res.first = date::sys_days(date::days(header.first_day));
+    return res;
+}
+
+sun::sun_times_file::sun_times_file(sun_times_file &&other) noexcept { *this = std::move(other); }
+
+auto sun::sun_times_file::operator=(sun_times_file &&other) noexcept -> sun_times_file & {
+    std::swap(map, other.map);
+    std::swap(map_size, other.map_size);
+    std::swap(data, other.data);
+    std::swap(source, other.source);
+    std::swap(mask, other.mask);
+    std::swap(location_count, other.location_count);
+    std::swap(day_count, other.day_count);
+    std::swap(first, other.first);
+    return *this;
+}
+
+sun::sun_times_file::~sun_times_file() {
+    if (map) unmap_file(map, map_size);
+}
+
+auto sun::sun_times_file::packed(std::size_t location, std::size_t day) const -> packed_sun_times {
+    packed_sun_times res{};
+    for (std::size_t e = 0; e < sun_event_count; e++) { res.events[e] = row(static_cast<sun_event>(e), day)[location]; }
+    return res;
+}
+
+auto sun::sun_times_file::get(std::size_t location, std::size_t day) const -> sun_times {
+    auto res = unpack(packed(location, day), date_of(day));
+    res.events = mask;
+    return res;
+}
+
+bool sun::write_sun_times_store(const char *path, const location *locations, std::size_t count,
+                                date::sys_days first_day, std::size_t days) {
+    store_header header{};
+    std::memcpy(header.magic, store_magic, sizeof(store_magic));
+    header.byte_order = byte_order;
+    header.version = version;
+    header.first_day = first_day.time_since_epoch().count();
+    header.locations = count;
+    header.days = days;
+
+    // Calculate everything first, as the entries in front depend on all days of their location
+    std::vector<packed_sun_times> packed(count * days);
+    std::vector<store_entry> entries(count);
+    auto offset = sizeof(header) + count * sizeof(store_entry);
+    for (std::size_t i = 0; i < count; i++) {
+        auto &entry = entries[i];
+        entry.latitude = locations[i].latitude.deg();
+        entry.longitude = locations[i].longitude.deg();
+        for (std::size_t day = 0; day < days; day++) {
+            const auto date = first_day + date::days(day);
+            packed[i * days + day] = pack(noaa::get_sun_times_opt(locations[i].latitude, locations[i].longitude, date),
+                                          date);
+        }
+
+        for (std::size_t e = 0; e < sun_event_count; e++) {
+            auto min = std::numeric_limits<std::int32_t>::max(), max = std::numeric_limits<std::int32_t>::min();
+            for (std::size_t day = 0; day < days; day++) {
+                const auto value = packed[i * days + day].events[e];
+                if (value == packed_sun_times::none) continue;
+                min = std::min(min, value);
+                max = std::max(max, value);
+            }
+            entry.base[e] = min <= max ? min : 0;
+            if (min <= max && std::int64_t{max} - min > max_narrow_delta) entry.wide = 1;
+        }
+        entry.offset = offset;
+        offset += days * sun_event_count * (entry.wide ? sizeof(std::int32_t) : sizeof(std::uint16_t));
+    }
+
+    auto file = std::fopen(path, "wb");
+    if (!file) return false;
+    auto ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    if (ok && count) ok = std::fwrite(entries.data(), sizeof(store_entry), count, file) == count;
+    for (std::size_t i = 0; ok && i < count; i++) {
+        const auto *first = packed.data() + i * days;
+        if (entries[i].wide) {
+            ok = std::fwrite(first, sizeof(packed_sun_times), days, file) == days;
+            continue;
+        }
+        std::vector<std::uint16_t> records(days * sun_event_count);
+        for (std::size_t j = 0; j < records.size(); j++) {
+            const auto value = first[j / sun_event_count].events[j % sun_event_count];
+            records[j] = value == packed_sun_times::none
+                                 ? store_none
+                                 : static_cast<std::uint16_t>(value - entries[i].base[j % sun_event_count]);
+        }
+        ok = std::fwrite(records.data(), sizeof(std::uint16_t), records.size(), file) == records.size();
+    }
+    return std::fclose(file) == 0 && ok;
+}
+
+auto sun::sun_times_store::open(const char *path) -> std::optional<sun_times_store> {
+    const auto [map, size] = map_file(path);
+    if (!map) return std::nullopt;
+
+    // From here on, res unmaps the file if it's invalid
+    sun_times_store res;
+    res.map = map;
+    res.map_size = size;
+
+    store_header header{};
+    std::memcpy(&header, map, sizeof(header));
+    if (std::memcmp(header.magic, store_magic, sizeof(store_magic)) != 0 || header.byte_order != byte_order ||
+        header.version != version || header.locations > (size - sizeof(header)) / sizeof(store_entry))
+        return std::nullopt;
+
+    // Every location needs all of its records within the file, so get never reads beyond it
+    const auto *entries = reinterpret_cast<const store_entry *>(static_cast<const char *>(map) + sizeof(header));
+    const auto records = sizeof(header) + header.locations * sizeof(store_entry);
+    for (std::size_t i = 0; i < header.locations; i++) {
+        const auto width = entries[i].wide ? sizeof(std::int32_t) : sizeof(std::uint16_t);
+        const auto offset = entries[i].offset;
+        if (offset < records || offset > size || offset % width != 0 ||
+            header.days > (size - offset) / width / sun_event_count)
+            return std::nullopt;
+    }
+
+    res.location_count = header.locations;
+    res.day_count = header.days;
+    res.first = date::sys_days(date::days(header.first_day));
+    return res;
+}
+
+sun::sun_times_store::sun_times_store(sun_times_store &&other) noexcept { *this = std::move(other); }
+
+auto sun::sun_times_store::operator=(sun_times_store &&other) noexcept -> sun_times_store & {
+    std::swap(map, other.map);
+    std::swap(map_size, other.map_size);
+    std::swap(location_count, other.location_count);
+    std::swap(day_count, other.day_count);
+    std::swap(first, other.first);
+    return *this;
+}
+
+sun::sun_times_store::~sun_times_store() {
+    if (map) unmap_file(map, map_size);
+}
+
+// Returns the entry of a location, which has to be below the number of locations in the header
+static auto entry_of(const void *map, std::size_t location) -> const store_entry & {
+    return reinterpret_cast<const store_entry *>(static_cast<const char *>(map) + sizeof(store_header))[location];
+}
+
+auto sun::sun_times_store::location_of(std::size_t location) const -> std::optional<sun::location> {
+    if (location >= location_count) return std::nullopt;
+    const auto &entry = entry_of(map, location);
+    return sun::location{Angle::from_deg(entry.latitude), Angle::from_deg(entry.longitude)};
+}
+
+auto sun::sun_times_store::get(std::size_t location, date::sys_days date) const -> std::optional<sun_times> {
+    const auto day = (date - first).count();
+    if (location >= location_count || day < 0 || static_cast<std::size_t>(day) >= day_count) return std::nullopt;
+
+    const auto &entry = entry_of(map, location);
+    const auto *records = static_cast<const char *>(map) + entry.offset;
+    packed_sun_times res{};
+    if (entry.wide) {
+        std::memcpy(&res, records + day * sizeof(packed_sun_times), sizeof(res));
+    } else {
+        const auto *record = reinterpret_cast<const std::uint16_t *>(records) + day * sun_event_count;
+        for (std::size_t e = 0; e < sun_event_count; e++) {
+            res.events[e] = record[e] == store_none ? packed_sun_times::none : entry.base[e] + record[e];
+        }
+    }
+    return unpack(res, date);
+}
@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
+
+// Parallel driver for location x date grids on top of the SoA kernel, with range stealing between the threads.
+
+#include "sun.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <vector>
+
+// Locations per task. Large enough to keep the SoA kernel busy, small enough to balance a grid of a single day.
+static constexpr std::size_t block_size = 1024;
+
+namespace {
+    // The tasks [begin, end) a thread has left, in one atomic word. The owner takes tasks from the front, and others
+    // take the back half of what's left. Both is a single compare-exchange, so there is no lock and a thread that
+    // loses a race just retries with the updated value.
+    struct alignas(64) task_range {
+        std::atomic<std::uint64_t> bounds{0};
+
+        static constexpr std::uint64_t pack(std::uint32_t begin, std::uint32_t end) {
+            return static_cast<std::uint64_t>(begin) << 32 | end;
+        }
+
+        void reset(std::uint32_t begin, std::uint32_t end) {
+            bounds.store(pack(begin, end), std::memory_order_release);
+        }
+
+        bool take_front(std::uint32_t &task) {
+            auto b = bounds.load(std::memory_order_acquire);
+            for (;;) {
+                auto begin = static_cast<std::uint32_t>(b >> 32), end = static_cast<std::uint32_t>(b);
+                if (begin >= end) return false;
+                if (bounds.compare_exchange_weak(b, pack(begin + 1, end), std::memory_order_acq_rel)) {
+                    task = begin;
+                    return true;
+                }
+            }
+        }
+
+        bool steal_back(std::uint32_t &first, std::uint32_t &last) {
+            auto b = bounds.load(std::memory_order_acquire);
+            for (;;) {
+                auto begin = static_cast<std::uint32_t>(b >> 32), end = static_cast<std::uint32_t>(b);
+                if (begin >= end) return false;
+                auto mid = end - (end - begin + 1) / 2;
+                if (bounds.compare_exchange_weak(b, pack(begin, mid), std::memory_order_acq_rel)) {
+                    first = mid;
+                    last = end;
+                    return true;
+                }
+            }
+        }
+    };
+}// namespace
+
+// The task ranges are 32 bits each, to fit both bounds into one atomic, so larger grids run in passes of this many.
+static constexpr std::uint64_t max_pass_tasks = std::numeric_limits<std::uint32_t>::max();
+
+// Runs the tasks [base, base + tasks) of a grid with blocks_per_day blocks per day, on threads threads
+static void run_pass(const Angle *latitude, const Angle *longitude, sun::sun_times_table &table, unsigned threads,
+                     std::size_t blocks_per_day, std::uint64_t base, std::uint32_t tasks) {
+    threads = std::min(threads, tasks);
+
+    // Task t is block t % blocks_per_day of day t / blocks_per_day, so neighbouring tasks write neighbouring memory.
+    auto run_task = [&](std::uint32_t task) {
+        const auto t = base + task;
+        const auto day = static_cast<std::size_t>(t / blocks_per_day);
+        const auto first = static_cast<std::size_t>(t % blocks_per_day) * block_size;
+        const auto count = std::min(block_size, table.locations() - first);
+        sun::noaa::get_sun_times_soa(latitude, longitude, first, count, table, day);
+    };
+
+    std::vector<task_range> ranges(threads);
+    for (unsigned i = 0; i < threads; i++) {
+        ranges[i].reset(static_cast<std::uint32_t>(std::uint64_t{tasks} * i / threads),
+                        static_cast<std::uint32_t>(std::uint64_t{tasks} * (i + 1) / threads));
+    }
+
+    auto worker = [&](unsigned self) {
+        std::uint32_t task, last;
+        for (;;) {
+            while (ranges[self].take_front(task)) { run_task(task); }
+
+            // Out of work: look for a victim, starting with the next thread so thieves spread out.
+            auto stolen = false;
+            for (unsigned i = 1; i < threads && !stolen; i++) {
+                stolen = ranges[(self + i) % threads].steal_back(task, last);
+            }
+            if (!stolen) return;
+
+            ranges[self].reset(task + 1, last);
+            run_task(task);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (unsigned i = 1; i < threads; i++) { pool.emplace_back(worker, i); }
+    worker(0);
+    for (auto &t: pool) { t.join(); }
+}
+
+void sun::noaa::get_sun_times_grid(const Angle *latitude, const Angle *longitude, sun_times_table &table,
+                                   unsigned threads) {
+    const auto blocks_per_day = (table.locations() + block_size - 1) / block_size;
+    const auto tasks = std::uint64_t{blocks_per_day} * table.days();
+    if (threads == 0) { threads = std::max(1u, std::thread::hardware_concurrency()); }
+    for (std::uint64_t base = 0; base < tasks; base += max_pass_tasks) {
+        const auto pass = static_cast<std::uint32_t>(std::min(tasks - base, max_pass_tasks));
+        run_pass(latitude, longitude, table, threads, blocks_per_day, base, pass);
+    }
+}
@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
+
+#include "sun.h"
+
+using date::sys_seconds;
+using std::optional;
+using std::chrono::seconds;
+
+static auto to_packed(sys_seconds tp, sys_seconds midnight) -> std::int32_t {
+    return static_cast<std::int32_t>((tp - midnight).count());
+}
+
+static auto to_packed(optional<sys_seconds> tp, sys_seconds midnight) -> std::int32_t {
+    return tp ? to_packed(*tp, midnight) : sun::packed_sun_times::none;
+}
+
+static auto from_packed(std::int32_t value, sys_seconds midnight) -> optional<sys_seconds> {
+    if (value != sun::packed_sun_times::none) return midnight + seconds(value);
+    else
+        return std::nullopt;
+}
+
+auto sun::pack(const sun_times &times, date::sys_days date) -> packed_sun_times {
+    const auto midnight = sys_seconds(date);
+    return {{
+            to_packed(times.noon, midnight),
+            to_packed(times.midnight, midnight),
+            to_packed(times.astro_dawn, midnight),
+            to_packed(times.naut_dawn, midnight),
+            to_packed(times.civil_dawn, midnight),
+            to_packed(times.sunrise, midnight),
+            to_packed(times.sunset, midnight),
+            to_packed(times.civil_dusk, midnight),
+            to_packed(times.naut_dusk, midnight),
+            to_packed(times.astro_dusk, midnight),
+    }};
+}
+
+auto sun::unpack(const packed_sun_times &packed, date::sys_days date) -> sun_times {
+    const auto midnight = sys_seconds(date);
+    return {
+            midnight + seconds(packed[sun_event::noon]),
+            midnight + seconds(packed[sun_event::midnight]),
+            from_packed(packed[sun_event::astro_dawn], midnight),
+            from_packed(packed[sun_event::naut_dawn], midnight),
+            from_packed(packed[sun_event::civil_dawn], midnight),
+            from_packed(packed[sun_event::sunrise], midnight),
+            from_packed(packed[sun_event::sunset], midnight),
+            from_packed(packed[sun_event::civil_dusk], midnight),
+            from_packed(packed[sun_event::naut_dusk], midnight),
+            from_packed(packed[sun_event::astro_dusk], midnight),
+    };
+}
+
+sun::sun_times_table::sun_times_table(std::size_t locations, date::sys_days first_day, std::size_t days)
+    : location_count(locations), day_count(days), first(first_day),
+      data(sun_event_count * days * locations, packed_sun_times::none) {}
+
+auto sun::sun_times_table::packed(std::size_t location, std::size_t day) const -> packed_sun_times {
+    packed_sun_times res{};
+    for (std::size_t e = 0; e < sun_event_count; e++) { res.events[e] = row(static_cast<sun_event>(e), day)[location]; }
+    return res;
+}
+
+auto sun::sun_times_table::get(std::size_t location, std::size_t day) const -> sun_times {
+    return unpack(packed(location, day), date_of(day));
+}
+
+void sun::sun_times_table::set(std::size_t location, std::size_t day, const sun_times &times) {
+    const auto p = pack(times, date_of(day));
+    for (std::size_t e = 0; e < sun_event_count; e++) { row(static_cast<sun_event>(e), day)[location] = p.events[e]; }
+}
@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
+
+// Local calendar days in a time zone, with the offsets of the zone read from the tz database once per range.
+
+#include "sun.h"
+#include <algorithm>
+#include <cmath>
+
+using date::local_days;
+using date::local_seconds;
+using date::sys_days;
+using date::sys_seconds;
+using std::optional;
+using std::chrono::seconds;
+
+sun::zone_offsets::zone_offsets(const date::time_zone *zone, sys_days first_day, sys_days last_day)
+    : tz(zone), first(first_day - date::days(1)), last(last_day + date::days(2)) {
+    auto info = tz->get_info(first);
+    starts.push_back(info.begin);
+    offsets.push_back(info.offset);
+    while (info.end < last) {
+        info = tz->get_info(info.end);
+        // Changes of only the abbreviation or the DST flag keep the offset
+        if (info.offset == offsets.back()) continue;
+        starts.push_back(info.begin);
+        offsets.push_back(info.offset);
+    }
+}
+
+auto sun::zone_offsets::index_of(sys_seconds tp) const -> std::size_t {
+    return static_cast<std::size_t>(std::upper_bound(starts.begin(), starts.end(), tp) - starts.begin()) - 1;
+}
+
+auto sun::zone_offsets::offset_at(sys_seconds tp) const -> seconds {
+    if (tp < first || tp >= last) return tz->get_info(tp).offset;
+    return offsets[index_of(tp)];
+}
+
+auto sun::zone_offsets::utc_date_of(local_days day, Angle longitude) const -> sys_days {
+    // The offset at local noon, where the local time is taken as UTC first and corrected once, which is close enough
+    // unless the zone changes its offset within the hours around noon
+    const auto noon = sys_seconds((day + std::chrono::hours(12)).time_since_epoch());
+    const auto offset = offset_at(noon - offset_at(noon));
+    // The solar time is 240 seconds ahead of UTC per degree of longitude
+    const auto shift = std::lround((static_cast<double>(offset.count()) - longitude.deg() * 240.0) / 86400.0);
+    return sys_days(day.time_since_epoch()) - date::days(shift);
+}
+
+auto sun::zone_offsets::to_local(const sun_times &times) const -> local_sun_times {
+    // All events are within a day or so of noon, which mostly lies in the same interval as all of them
+    const auto in_range = times.noon >= first && times.noon < last;
+    const auto i = in_range ? index_of(times.noon) : 0;
+    const auto begin = in_range ? starts[i] : sys_seconds::max();
+    const auto end = in_range && i + 1 < starts.size() ? starts[i + 1] : last;
+    auto local = [&](sys_seconds tp) {
+        const auto offset = tp >= begin && tp < end ? offsets[i] : offset_at(tp);
+        return local_seconds((tp + offset).time_since_epoch());
+    };
+    auto local_opt = [&](optional<sys_seconds> tp) -> optional<local_seconds> {
+        if (tp) return local(*tp);
+        else
+            return std::nullopt;
+    };
+    return {local(times.noon),
+            local(times.midnight),
+            local_opt(times.astro_dawn),
+            local_opt(times.naut_dawn),
+            local_opt(times.civil_dawn),
+            local_opt(times.sunrise),
+            local_opt(times.sunset),
+            local_opt(times.civil_dusk),
+            local_opt(times.naut_dusk),
+            local_opt(times.astro_dusk),
+            times.events};
+}
+
+auto sun::noaa::get_local_sun_times(Angle latitude, Angle longitude, local_days day, const zone_offsets &zone,
+                                    sun_event_mask events) -> local_sun_times {
+    return zone.to_local(get_sun_times_opt(latitude, longitude, zone.utc_date_of(day, longitude), events));
+}
+
+void sun::noaa::get_local_sun_times_batch(const location *locations, std::size_t count, local_days day,
+                                          const zone_offsets &zone, local_sun_times *out, sun_event_mask events) {
+    if (!count) return;
+    std::vector<sys_days> dates(count);
+    for (std::size_t i = 0; i < count; i++) { dates[i] = zone.utc_date_of(day, locations[i].longitude); }
+    std::vector<sun_times> times(count);
+
+    // The common case: the whole zone maps to one UTC date
+    if (std::all_of(dates.begin(), dates.end(), [&](sys_days date) { return date == dates.front(); })) {
+        get_sun_times_batch(locations, count, dates.front(), times.data(), events);
+        for (std::size_t i = 0; i < count; i++) { out[i] = zone.to_local(times[i]); }
+        return;
+    }
+
+    // Otherwise, zones spanning more than 24 hours of solar time, one batch per date
+    const auto [min, max] = std::minmax_element(dates.begin(), dates.end());
+    std::vector<location> subset;
+    std::vector<std::size_t> indices;
+    for (auto date = *min; date <= *max; date += date::days(1)) {
+        subset.clear();
+        indices.clear();
+        for (std::size_t i = 0; i < count; i++) {
+            if (dates[i] != date) continue;
+            subset.push_back(locations[i]);
+            indices.push_back(i);
+        }
+        get_sun_times_batch(subset.data(), subset.size(), date, times.data(), events);
+        for (std::size_t j = 0; j < indices.size(); j++) { out[indices[j]] = zone.to_local(times[j]); }
+    }
+}
@@ -9,6 +9,7 @@
 using date::days;
 using date::local_days;
 using date::local_seconds;
+using date::sys_days;
 using date::sys_seconds;
 using date::zoned_seconds;
 using std::optional;
@@ -52,17 +53,19 @@ int main() {
         fmt::print("{}: {} | {} | elev: {:.2f}\n", str, my_str, rs_str, elev.deg());
     };
 
+    const auto first_day = sys_days(floor<days>(dates.front()).time_since_epoch());
+    const auto last_day = sys_days(floor<days>(dates.back()).time_since_epoch());
     for (auto loc: locations) {
         fmt::print("Zone: {}\n", loc.zone);
+        const auto zone = sun::zone_offsets(date::locate_zone(loc.zone), first_day, last_day);
         for (auto local_date: dates) {
             auto lat = Angle::from_deg(loc.latitude);
             auto lon = Angle::from_deg(loc.longitude);
-            auto date = zoned_seconds{loc.zone, local_date};
+            auto date = zoned_seconds{zone.zone(), local_date};
 
-            // To get the correct UTC day for a given local time, we have to add the timezone offset
-            // before flooring for days. This is purely for humans though.
-            auto offset = (date.get_info().offset > 12h) ? date.get_info().offset - 24h : date.get_info().offset;
-            auto utc_date = floor<days>(date.get_sys_time() + offset);
+            // The UTC day whose solar noon is on the local day of the given local time. This is purely for humans
+            // though.
+            auto utc_date = zone.utc_date_of(floor<days>(local_date), lon);
 
             auto times = sun::noaa::get_sun_times(lat, lon, utc_date);
             auto times2 = sun::get_sun_times_rust(lat, lon, utc_date);
@@ -2,6 +2,7 @@
 // SPDX-FileCopyrightText: 2022-2023 Eicke Herbertz
 
 #include "angle.h"
+#include "instrumentation.h"
 #include "julian_date.h"
 #include "sun.h"
 
@@ -63,6 +64,7 @@ static Angle hour_angle(Angle latitude, Angle declination, Angle time_angle) {
 }
 
 optional<sys_seconds> sun::wiki::get_sun_time(Angle latitude, Angle longitude, sys_days date, Angle elevation) {
+    SUN_COUNT(wiki_sun_time);
     auto j_day = to_julian_day(date);
     auto mst = mean_solar_time(j_day, longitude);
     auto sma = solar_mean_anomaly(mst);
@@ -81,23 +83,31 @@ optional<sys_seconds> sun::wiki::get_sun_time(Angle latitude, Angle longitude, s
     }
 
     if (std::isnan(result.time_since_epoch().count())) {
+        SUN_COUNT(wiki_missing_events);
         return std::nullopt;
     } else {
         return floor<seconds>(julian_to_sys(result));
     }
 }
 
-auto sun::wiki::get_sun_times(Angle lat, Angle lon, date::sys_days date) -> sun_times {
+auto sun::wiki::get_sun_times(Angle lat, Angle lon, date::sys_days date, sun_event_mask events) -> sun_times {
+    events = (events & all_sun_events) | sun_event::noon | sun_event::midnight;
+    auto get = [&](sun_event event, Angle elevation) -> optional<sys_seconds> {
+        if (events & mask_of(event)) return get_sun_time(lat, lon, date, elevation);
+        else
+            return std::nullopt;
+    };
     return {
             get_sun_time(lat, lon, date, SunTime::Noon).value(),
             get_sun_time(lat, lon, date, SunTime::Midnight).value(),
-            get_sun_time(lat, lon, date, SunTime::AstroDawn),
-            get_sun_time(lat, lon, date, SunTime::NautDawn),
-            get_sun_time(lat, lon, date, SunTime::CivilDawn),
-            get_sun_time(lat, lon, date, SunTime::Sunrise),
-            get_sun_time(lat, lon, date, SunTime::Sunset),
-            get_sun_time(lat, lon, date, SunTime::CivilDusk),
-            get_sun_time(lat, lon, date, SunTime::NautDusk),
-            get_sun_time(lat, lon, date, SunTime::AstroDusk),
+            get(sun_event::astro_dawn, SunTime::AstroDawn),
+            get(sun_event::naut_dawn, SunTime::NautDawn),
+            get(sun_event::civil_dawn, SunTime::CivilDawn),
+            get(sun_event::sunrise, SunTime::Sunrise),
+            get(sun_event::sunset, SunTime::Sunset),
+            get(sun_event::civil_dusk, SunTime::CivilDusk),
+            get(sun_event::naut_dusk, SunTime::NautDusk),
+            get(sun_event::astro_dusk, SunTime::AstroDusk),
+            events,
     };
 }
@@ -0,0 +1,32 @@
+//! Compiles the NOAA kernel of ../cpp/noaa_core.c, which the crate is an adapter for, when cargo runs on its own, like
+//! for `cargo test`. The CMake build sets CARGO_CMD and links its noaa_core target to the crate instead.
+
+use std::env;
+use std::path::PathBuf;
+use std::process::Command;
+
+fn run(command: &mut Command) {
+    let status = command.status().unwrap_or_else(|e| panic!("{:?}: {}", command, e));
+    assert!(status.success(), "{:?}: {}", command, status);
+}
+
+fn main() {
+    println!("cargo:rerun-if-env-changed=CARGO_CMD");
+    if env::var_os("CARGO_CMD").is_some() {
+        return;
+    }
+
+    let source = PathBuf::from(env::var_os("CARGO_MANIFEST_DIR").unwrap()).join("../cpp/noaa_core.c");
+    let out_dir = PathBuf::from(env::var_os("OUT_DIR").unwrap());
+    let object = out_dir.join("noaa_core.o");
+    println!("cargo:rerun-if-changed=../cpp/noaa_core.c");
+    println!("cargo:rerun-if-changed=../cpp/noaa_core.h");
+
+    let cc = env::var_os("CC").unwrap_or_else(|| "cc".into());
+    let ar = env::var_os("AR").unwrap_or_else(|| "ar".into());
+    run(Command::new(cc).args(["-O3", "-std=c99", "-fPIC", "-c"]).arg(&source).arg("-o").arg(&object));
+    run(Command::new(ar).arg("crs").arg(out_dir.join("libnoaa_core.a")).arg(&object));
+
+    println!("cargo:rustc-link-search=native={}", out_dir.display());
+    println!("cargo:rustc-link-lib=static=noaa_core");
+}
@@ -1,25 +1,27 @@
-use chrono::{DateTime, Duration, NaiveDate, NaiveDateTime, NaiveTime, TimeZone, Utc};
-use angle::Angle;
-use astro::{time_of_solar_elevation, time_of_solar_noon};
-use julian::{JulianCentury, JulianDay};
+use chrono::{DateTime, NaiveDate, NaiveTime, TimeZone, Utc};
 
-mod angle;
-mod astro;
-mod julian;
-
-enum SunTime {
-    Noon,
-    Midnight,
-    AstroDawn,
-    NautDawn,
-    CivilDawn,
-    Sunrise,
-    Sunset,
-    CivilDusk,
-    NautDusk,
-    AstroDusk,
+// All events are calculated by the NOAA kernel of cpp/noaa_core.c, this crate only converts its types. The build
+// links it from the noaa_core target of CMake, or build.rs compiles it when cargo runs on its own.
+extern "C" {
+    fn noaa_core_sun_times(latitude: f64, longitude: f64, day: i64, mask: u32, times: *mut i64) -> u32;
+    fn noaa_core_sun_times_batch(
+        latitude: *const f64,
+        longitude: *const f64,
+        count: usize,
+        day: i64,
+        mask: u32,
+        times: *mut i64,
+        site_stride: usize,
+        event_stride: usize,
+    );
 }
 
+/// The events of a day, in the order of the fields of SunTimesC and the bits of the masks
+const EVENT_COUNT: usize = 10;
+
+/// The time noaa_core leaves for an event that doesn't happen or that wasn't asked for
+const NONE: i64 = i64::MIN;
+
 pub struct SunTimes {
     pub noon: DateTime<Utc>,
     pub midnight: DateTime<Utc>,
@@ -34,6 +36,7 @@ pub struct SunTimes {
 }
 
 #[repr(C)]
+#[derive(Default)]
 pub struct SunTimesC {
     pub noon: i64,
     pub midnight: i64,
@@ -47,89 +50,118 @@ pub struct SunTimesC {
     pub astro_dusk: i64,
 }
 
-const ASTRO_TWILIGHT_ELEV: f64 = -18.0;
-const NAUT_TWILIGHT_ELEV: f64 = -12.0;
-const CIVIL_TWILIGHT_ELEV: f64 = -6.0;
-const DAYTIME_ELEV: f64 = -0.833;
+// SunTimesC is filled by noaa_core as an array of EVENT_COUNT times
+const _: () = assert!(std::mem::size_of::<SunTimesC>() == EVENT_COUNT * std::mem::size_of::<i64>());
 
-fn time_angle(time_type: SunTime) -> Angle {
-    match time_type {
-        SunTime::AstroDawn => Angle::from_deg(-90.0 + ASTRO_TWILIGHT_ELEV),
-        SunTime::NautDawn => Angle::from_deg(-90.0 + NAUT_TWILIGHT_ELEV),
-        SunTime::CivilDawn => return Angle::from_deg(-90.0 + CIVIL_TWILIGHT_ELEV),
-        SunTime::Sunrise => return Angle::from_deg(-90.0 + DAYTIME_ELEV),
-        SunTime::Sunset => return Angle::from_deg(90.0 - DAYTIME_ELEV),
-        SunTime::CivilDusk => return Angle::from_deg(90.0 - CIVIL_TWILIGHT_ELEV),
-        SunTime::NautDusk => return Angle::from_deg(90.0 - NAUT_TWILIGHT_ELEV),
-        SunTime::AstroDusk => return Angle::from_deg(90.0 - ASTRO_TWILIGHT_ELEV),
-        _ => panic!("Invalid time angle"),
+impl SunTimesC {
+    fn times(&mut self) -> &mut [i64; EVENT_COUNT] {
+        // SAFETY: repr(C) struct of EVENT_COUNT i64 fields, without padding as asserted above
+        unsafe { &mut *(self as *mut Self as *mut [i64; EVENT_COUNT]) }
     }
 }
 
-fn get_sun_time(
-    latitude: Angle,
-    longitude: Angle,
-    date: NaiveDate,
-    ty: SunTime,
-) -> Option<DateTime<Utc>> {
-    // The requested midnight UTC time point in julian days. This is the mathematical baseline for all the
-    // hour angles we will calculate. We have to cast to seconds first to keep the midnight part.
-    let start_of_julian_century = JulianDay(2451545.0);
-    let j_day = JulianCentury::from_date(date) - start_of_julian_century;
+/// The events of a location at the date of day, like noaa_core leaves them, so events that don't happen or aren't in
+/// mask are NONE
+fn core_sun_times(latitude: f64, longitude: f64, day: i64, mask: u32) -> SunTimesC {
+    let mut res = SunTimesC::default();
+    // SAFETY: times() has room for the EVENT_COUNT times
+    unsafe { noaa_core_sun_times(latitude, longitude, day, mask, res.times().as_mut_ptr()) };
+    res
+}
 
-    let date = date.and_time(NaiveTime::default());
-    let date = Utc.from_utc_datetime(&date);
-    let a_noon = time_of_solar_noon(j_day, longitude);
-    let j_noon = j_day + a_noon;
-    let t_noon = date + Duration::from(a_noon);
+/// Same as core_sun_times for all locations, into out
+fn core_sun_times_batch(latitude: &[f64], longitude: &[f64], day: i64, mask: u32, out: &mut [SunTimesC]) {
+    assert!(latitude.len() == out.len() && longitude.len() == out.len());
+    // SAFETY: all slices have out.len() entries, with EVENT_COUNT times in each entry of out
+    unsafe {
+        noaa_core_sun_times_batch(
+            latitude.as_ptr(),
+            longitude.as_ptr(),
+            out.len(),
+            day,
+            mask,
+            out.as_mut_ptr() as *mut i64,
+            EVENT_COUNT,
+            1,
+        );
+    }
+}
 
-    match ty {
-        SunTime::Noon => Some(t_noon),
-        SunTime::Midnight => Some(t_noon + Duration::hours(12)),
-        ty => {
-            let angle = time_of_solar_elevation(j_noon, latitude, longitude, time_angle(ty));
-            if !angle.0.is_nan() {
-                Some(date + Duration::from(angle))
-            } else {
-                None
-            }
+/// Changes results of noaa_core to the C conventions of get_sun_times_mask_r, where missing events are 0
+fn to_c(res: &mut SunTimesC) {
+    for t in res.times().iter_mut() {
+        if *t == NONE {
+            *t = 0;
         }
     }
 }
 
+/// Bit mask of all events, with bit n standing for field n of SunTimesC. Noon and midnight are always calculated.
+pub const ALL_SUN_TIMES: u32 = (1 << 10) - 1;
+
 pub fn get_sun_times2(latitude: f64, longitude: f64, date: NaiveDate) -> SunTimes {
-    let lat = Angle::from_deg(latitude);
-    let lon = Angle::from_deg(longitude);
+    get_sun_times_masked(latitude, longitude, date, ALL_SUN_TIMES)
+}
+
+/// Like get_sun_times2, but only calculates the events in mask. The others are None.
+pub fn get_sun_times_masked(latitude: f64, longitude: f64, date: NaiveDate, mask: u32) -> SunTimes {
+    let midnight = Utc.from_utc_datetime(&date.and_time(NaiveTime::default()));
+    let res = core_sun_times(latitude, longitude, midnight.timestamp(), mask);
+    let get = |t: i64| if t != NONE { Utc.timestamp_opt(t, 0).single() } else { None };
     SunTimes {
-        noon: get_sun_time(lat, lon, date, SunTime::Noon).unwrap(),
-        midnight: get_sun_time(lat, lon, date, SunTime::Midnight).unwrap(),
-        astro_dawn: get_sun_time(lat, lon, date, SunTime::AstroDawn),
-        naut_dawn: get_sun_time(lat, lon, date, SunTime::NautDawn),
-        civil_dawn: get_sun_time(lat, lon, date, SunTime::CivilDawn),
-        sunrise: get_sun_time(lat, lon, date, SunTime::Sunrise),
-        sunset: get_sun_time(lat, lon, date, SunTime::Sunset),
-        civil_dusk: get_sun_time(lat, lon, date, SunTime::CivilDusk),
-        naut_dusk: get_sun_time(lat, lon, date, SunTime::NautDusk),
-        astro_dusk: get_sun_time(lat, lon, date, SunTime::AstroDusk),
+        noon: get(res.noon).unwrap(),
+        midnight: get(res.midnight).unwrap(),
+        astro_dawn: get(res.astro_dawn),
+        naut_dawn: get(res.naut_dawn),
+        civil_dawn: get(res.civil_dawn),
+        sunrise: get(res.sunrise),
+        sunset: get(res.sunset),
+        civil_dusk: get(res.civil_dusk),
+        naut_dusk: get(res.naut_dusk),
+        astro_dusk: get(res.astro_dusk),
     }
 }
 
 #[no_mangle]
 pub extern "C" fn get_sun_times_r(latitude: f64, longitude: f64, tp: i64) -> SunTimesC {
-    let date = NaiveDateTime::from_timestamp_opt(tp, 0).unwrap().date();
-    let res = get_sun_times2(latitude, longitude, date);
+    get_sun_times_mask_r(latitude, longitude, tp, ALL_SUN_TIMES)
+}
+
+#[no_mangle]
+pub extern "C" fn get_sun_times_mask_r(latitude: f64, longitude: f64, tp: i64, mask: u32) -> SunTimesC {
+    let mut res = core_sun_times(latitude, longitude, tp, mask);
+    to_c(&mut res);
+    res
+}
+
+/// Calculates the events of count locations on days consecutive dates, starting with the date of first_date. Results
+/// are written to out[day * count + location] like get_sun_times_mask_r returns them, so out needs room for count *
+/// days of them. This is one call for a whole table, with no conversions to and from chrono types on the way.
+///
+/// # Safety
+///
+/// latitude and longitude have to point to count values each, and out has to point to count * days writable values.
+#[no_mangle]
+pub unsafe extern "C" fn get_sun_times_batch_r(
+    latitude: *const f64,
+    longitude: *const f64,
+    count: usize,
+    first_date: i64,
+    days: usize,
+    mask: u32,
+    out: *mut SunTimesC,
+) {
+    if count == 0 || days == 0 {
+        return;
+    }
+    let latitude = std::slice::from_raw_parts(latitude, count);
+    let longitude = std::slice::from_raw_parts(longitude, count);
+    let out = std::slice::from_raw_parts_mut(out, count * days);
 
-    SunTimesC {
-        noon: res.noon.timestamp(),
-        midnight: res.midnight.timestamp(),
-        astro_dawn: res.astro_dawn.unwrap_or_default().timestamp(),
-        naut_dawn: res.naut_dawn.unwrap_or_default().timestamp(),
-        civil_dawn: res.civil_dawn.unwrap_or_default().timestamp(),
-        sunrise: res.sunrise.unwrap_or_default().timestamp(),
-        sunset: res.sunset.unwrap_or_default().timestamp(),
-        civil_dusk: res.civil_dusk.unwrap_or_default().timestamp(),
-        naut_dusk: res.naut_dusk.unwrap_or_default().timestamp(),
-        astro_dusk: res.astro_dusk.unwrap_or_default().timestamp(),
+    let first_midnight = first_date.div_euclid(86400) * 86400;
+    for (day, row) in out.chunks_exact_mut(count).enumerate() {
+        core_sun_times_batch(latitude, longitude, first_midnight + day as i64 * 86400, mask, row);
+        row.iter_mut().for_each(to_c);
     }
 }
 